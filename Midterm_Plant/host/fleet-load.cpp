@@ -0,0 +1,466 @@
+// Broker load generator: thousands of virtual plant controllers in one
+// process, each an Adafruit_MQTT client on its own non-blocking socket, all
+// driven by one epoll loop.
+//
+//   fleet-load [host] [port] [clients] [compression] [seconds]
+//
+// defaults 127.0.0.1 1883 1000 60 0 (0 runs until interrupted).  Each plant
+// follows the firmware's cadence, sped up by compression:
+//   - CONNECT, then SUBSCRIBE to its turnonpump feed
+//   - the five sensor feeds every 15 s, QoS 0
+//   - a ping every 60 s
+//   - a pump command to its neighbour every 5 minutes, carrying the send
+//     time, so delivery through the broker is timed end to end
+//   - every hour everyone drops and reconnects at once, a connect storm
+// Every 10 s it reports the publish rate and connect, ping and pump
+// delivery percentiles.
+//
+// connect(), ping() and QoS 1 publish() wait for the broker's answer, which
+// one loop serving every client can't do.  So the plants send the library's
+// packets themselves and pick up the answers as they arrive; incoming
+// PUBLISH packets go through readSubscription() as on the device.
+
+#include <vector>
+
+#include "Adafruit_MQTT.h"
+#include "Adafruit_MQTT_Latency.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const uint32_t PUBLISH_MS = 15000;   // firmware timings, before compression
+const uint32_t PING_MS = 60000;
+const uint32_t PUMP_MS = 300000;
+const uint32_t STORM_MS = 3600000;
+const uint32_t REPORT_MS = 10000;    // real time
+const uint32_t RETRY_MS = 1000;      // after a failed connect, plus up to as much again
+
+// Unsent bytes a plant may hold before publishes fail: the broker isn't
+// keeping up.
+const size_t TX_LIMIT = 16384;
+
+const char *const FEEDS[5] = { "planthumid", "planttemp", "plantair", "plantmois", "plantdust" };
+
+static uint32_t compression = 60;
+static sockaddr_storage brokerAddr;
+static socklen_t brokerAddrLen;
+static int epfd;
+
+static Adafruit_MQTT_Latency connectLatency;
+static Adafruit_MQTT_Latency pingLatency;
+static Adafruit_MQTT_Latency pumpLatency;
+
+static uint32_t published, publishFailed, pumpSent, pumpReceived;
+static uint32_t connects, connectFailed, dropped, pingsLost, oversized;
+
+static uint32_t compressed(uint32_t ms) {
+  uint32_t t = ms / compression;
+  return t ? t : 1;
+}
+
+static bool due(uint32_t now, uint32_t at) {
+  return (int32_t)(now - at) >= 0;
+}
+
+class Plant;
+static std::vector<Plant *> plants;
+static std::vector<Plant *> pendingTx;
+
+class Plant : public Adafruit_MQTT {
+ public:
+  enum State { IDLE, CONNECTING, CONNACK_WAIT, SUBACK_WAIT, RUNNING };
+
+  Plant(uint32_t n) : Adafruit_MQTT("", 0, cid, "", ""), pump(this, pumpTopic) {
+    snprintf(cid, sizeof(cid), "loadplant%05u", (unsigned)n);
+    for (uint8_t f = 0; f < 5; f++) {
+      snprintf(feedTopics[f], sizeof(feedTopics[f]), "loadtest/%s/feeds/%s", cid, FEEDS[f]);
+      feeds[f] = new Adafruit_MQTT_Publish(this, feedTopics[f]);
+    }
+    snprintf(pumpTopic, sizeof(pumpTopic), "loadtest/%s/feeds/turnonpump", cid);
+    subscribe(&pump);
+  }
+
+  bool connected() { return state == RUNNING; }
+
+  // The plant's timers, called about once a millisecond.
+  void run(uint32_t index, uint32_t now) {
+    if (state == IDLE) {
+      if (due(now, retryAt))
+        start();
+      return;
+    }
+    if (state != RUNNING) {
+      if (now - stateSince > CONNECT_TIMEOUT_MS)
+        fail();
+      return;
+    }
+
+    if (due(now, nextPublish)) {
+      nextPublish += compressed(PUBLISH_MS);
+      for (uint8_t f = 0; f < 5; f++) {
+        value += (random(21) - 10) / 10.0;
+        if (feeds[f]->publish(value)) published++;
+        else publishFailed++;
+      }
+    }
+
+    if (due(now, nextPing)) {
+      nextPing += compressed(PING_MS);
+      if (pingOutstanding)
+        pingsLost++;
+      pingOutstanding = sendPacket(buffer, pingPacket(buffer));
+      pingSentAt = micros();
+    }
+
+    if (due(now, nextPump)) {
+      nextPump += compressed(PUMP_MS);
+      char payload[12];
+      snprintf(payload, sizeof(payload), "%lu", (unsigned long)(uint32_t)micros());
+      if (publish(plants[(index + 1) % plants.size()]->pumpTopic, payload)) pumpSent++;
+    }
+  }
+
+  // Starts a connect, CONNECT goes out when the socket is writable.
+  void start() {
+    if (connectServer()) {
+      state = CONNECTING;
+      stateSince = millis();
+      connectStart = micros();
+    } else {
+      fail();
+    }
+  }
+
+  // Hangs up wherever it got to, with a DISCONNECT if it was connected.
+  void drop() {
+    if (connected()) disconnect();
+    else disconnectServer();
+  }
+
+  void fail() {
+    if (state == RUNNING) dropped++;
+    else connectFailed++;
+    disconnectServer();
+    retryAt = millis() + RETRY_MS + random(RETRY_MS);
+  }
+
+  void writable() {
+    if (fd < 0)
+      return;
+    if (state == CONNECTING) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) {
+        fail();
+        return;
+      }
+      state = CONNACK_WAIT;
+      sendPacket(buffer, connectPacket(buffer));
+    }
+    flush();
+  }
+
+  void readable() {
+    if (fd < 0)
+      return;
+    for (;;) {
+      uint8_t chunk[4096];
+      ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+      if (n > 0) {
+        rx.insert(rx.end(), chunk, chunk + n);
+        continue;
+      }
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      fail();  // closed by the broker, or reset
+      return;
+    }
+
+    uint16_t len;
+    while (fd >= 0 && (len = packetLength())) {
+      uint8_t type = rx[rxHead] >> 4;
+      if (len >= MAXBUFFERSIZE) {
+        // no plant is sent anything this long, don't let it desync the stream
+        rxHead += len;
+        oversized++;
+      } else if (type == MQTT_CTRL_PUBLISH) {
+        if (readSubscription(0) == &pump) {
+          pumpLatency.record((uint32_t)micros() - strtoul((char *)pump.lastread, NULL, 10));
+          pumpReceived++;
+        }
+      } else {
+        readFullPacket(buffer, MAXBUFFERSIZE, 0);
+        answer(type);
+      }
+    }
+    if (rxHead == rx.size()) {
+      rx.clear();
+      rxHead = 0;
+    }
+  }
+
+  // Sends what's queued until the socket is full, then waits for EPOLLOUT.
+  void flush() {
+    queued = false;
+    while (fd >= 0 && txHead < tx.size()) {
+      ssize_t n = send(fd, tx.data() + txHead, tx.size() - txHead, MSG_NOSIGNAL);
+      if (n > 0) {
+        txHead += n;
+      } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      } else {
+        fail();
+        return;
+      }
+    }
+    if (fd < 0 || state == CONNECTING)
+      return;
+    if (txHead == tx.size()) {
+      tx.clear();
+      txHead = 0;
+    }
+    watch(!tx.empty());
+  }
+
+  char cid[16];
+  char pumpTopic[48];
+
+ protected:
+  bool connectServer() {
+    fd = socket(brokerAddr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+      return false;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (::connect(fd, (sockaddr *)&brokerAddr, brokerAddrLen) < 0 && errno != EINPROGRESS)
+      return false;
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = this;
+    watchingOut = true;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+  }
+
+  bool disconnectServer() {
+    if (fd >= 0) {
+      if (txHead < tx.size())
+        send(fd, tx.data() + txHead, tx.size() - txHead, MSG_NOSIGNAL);
+      close(fd);  // also leaves the epoll set
+    }
+    fd = -1;
+    state = IDLE;
+    rx.clear();
+    tx.clear();
+    rxHead = txHead = 0;
+    pingOutstanding = false;
+    return true;
+  }
+
+  bool sendPacket(uint8_t *buffer, uint16_t len) {
+    if (fd < 0 || tx.size() - txHead + len > TX_LIMIT)
+      return false;
+    tx.insert(tx.end(), buffer, buffer + len);
+    if (!queued) {
+      queued = true;
+      pendingTx.push_back(this);
+    }
+    return true;
+  }
+
+  uint16_t readPacket(uint8_t *buffer, uint16_t maxlen, int16_t timeout) {
+    uint16_t n = min(maxlen, rx.size() - rxHead);
+    memcpy(buffer, rx.data() + rxHead, n);
+    rxHead += n;
+    if (n == 0)
+      rxIdle();
+    return n;
+  }
+
+  // Only whole packets count as waiting, so the library never reads one
+  // that is still arriving.
+  int bytesAvailable() { return packetLength() ? rx.size() - rxHead : 0; }
+
+ private:
+  int fd = -1;
+  State state = IDLE;
+  bool queued = false, watchingOut = false, pingOutstanding = false;
+  uint32_t stateSince, connectStart, pingSentAt;
+  uint32_t nextPublish, nextPing, nextPump, retryAt = 0;
+  float value = 50;
+
+  std::vector<uint8_t> rx, tx;
+  size_t rxHead = 0, txHead = 0;
+
+  char feedTopics[5][48];
+  Adafruit_MQTT_Publish *feeds[5];
+  Adafruit_MQTT_Subscribe pump;
+
+  // Length of the packet at the head of rx if all of it is here, else 0.
+  uint16_t packetLength() {
+    size_t have = rx.size() - rxHead;
+    uint32_t remaining = 0;
+    for (uint8_t i = 1; i <= 4 && i < have; i++) {
+      remaining |= (rx[rxHead + i] & 0x7F) << (7 * (i - 1));
+      if (!(rx[rxHead + i] & 0x80)) {
+        uint32_t len = 1 + i + remaining;
+        return len <= have && len <= 0xFFFF ? len : 0;
+      }
+    }
+    return 0;
+  }
+
+  void answer(uint8_t type) {
+    if (type == MQTT_CTRL_CONNECTACK && state == CONNACK_WAIT) {
+      if (buffer[3] != 0) {
+        fail();
+        return;
+      }
+      state = SUBACK_WAIT;
+      sendPacket(buffer, subscribePacket(buffer, pumpTopic, 0));
+    } else if (type == MQTT_CTRL_SUBACK && state == SUBACK_WAIT) {
+      state = RUNNING;
+      connectLatency.record((uint32_t)micros() - connectStart);
+      connects++;
+      // spread the first publishes over the period like a real fleet
+      uint32_t now = millis();
+      nextPublish = now + random(compressed(PUBLISH_MS));
+      nextPing = now + compressed(PING_MS);
+      nextPump = now + random(compressed(PUMP_MS));
+    } else if (type == MQTT_CTRL_PINGRESP && pingOutstanding) {
+      pingLatency.record((uint32_t)micros() - pingSentAt);
+      pingOutstanding = false;
+    }
+  }
+
+  void watch(bool out) {
+    if (out == watchingOut)
+      return;
+    epoll_event ev = {};
+    ev.events = EPOLLIN | (out ? EPOLLOUT : 0);
+    ev.data.ptr = this;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+    watchingOut = out;
+  }
+};
+
+static void report(uint32_t elapsedMs) {
+  double secs = elapsedMs ? elapsedMs / 1000.0 : 1;
+  uint32_t up = 0;
+  for (Plant *p : plants)
+    up += p->connected();
+  printf("\n%u clients (%u up), x%u: %.1f msg/s published (%u failed), pump %u/%u delivered\n",
+         (unsigned)plants.size(), up, compression, published / secs, publishFailed,
+         pumpReceived, pumpSent);
+  printf("connects %u (%u failed, %u dropped): p50 %u us, p99 %u us, worst %u us\n",
+         connects, connectFailed, dropped, connectLatency.percentile(50),
+         connectLatency.percentile(99), connectLatency.worst());
+  printf("ping: p50 %u us, p99 %u us, %u unanswered   pump delivery: p50 %u us, p99 %u us, worst %u us\n",
+         pingLatency.percentile(50), pingLatency.percentile(99), pingsLost,
+         pumpLatency.percentile(50), pumpLatency.percentile(99), pumpLatency.worst());
+  if (oversized)
+    printf("%u oversized packets skipped\n", oversized);
+  fflush(stdout);
+
+  published = publishFailed = pumpSent = pumpReceived = 0;
+  connects = connectFailed = dropped = pingsLost = oversized = 0;
+  connectLatency.reset();
+  pingLatency.reset();
+  pumpLatency.reset();
+}
+
+int main(int argc, char **argv) {
+  const char *host = argc > 1 ? argv[1] : "127.0.0.1";
+  const char *port = argc > 2 ? argv[2] : "1883";
+  uint32_t clients = argc > 3 ? strtoul(argv[3], NULL, 10) : 1000;
+  compression = argc > 4 ? strtoul(argv[4], NULL, 10) : 60;
+  uint32_t seconds = argc > 5 ? strtoul(argv[5], NULL, 10) : 0;
+  if (clients < 1 || compression < 1) {
+    fprintf(stderr, "usage: %s [host] [port] [clients] [compression] [seconds]\n", argv[0]);
+    return 2;
+  }
+
+  // a descriptor per client
+  rlimit files;
+  getrlimit(RLIMIT_NOFILE, &files);
+  files.rlim_cur = files.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &files);
+  if (clients + 16 > files.rlim_cur) {
+    clients = files.rlim_cur - 16;
+    fprintf(stderr, "open file limit %lu, running %u clients\n",
+            (unsigned long)files.rlim_cur, clients);
+  }
+
+  addrinfo hints = {}, *found;
+  hints.ai_socktype = SOCK_STREAM;
+  int err = getaddrinfo(host, port, &hints, &found);
+  if (err) {
+    fprintf(stderr, "%s: %s\n", host, gai_strerror(err));
+    return 1;
+  }
+  memcpy(&brokerAddr, found->ai_addr, found->ai_addrlen);
+  brokerAddrLen = found->ai_addrlen;
+  freeaddrinfo(found);
+
+  signal(SIGPIPE, SIG_IGN);
+  epfd = epoll_create1(0);
+  for (uint32_t i = 0; i < clients; i++)
+    plants.push_back(new Plant(i));
+
+  // everyone at once, the first connect storm
+  uint32_t begin = millis();
+  uint32_t lastRun = begin - 1;
+  uint32_t nextStorm = begin + compressed(STORM_MS);
+  uint32_t nextReport = begin + REPORT_MS, reportStart = begin;
+
+  std::vector<epoll_event> events(1024);
+  while (!seconds || millis() - begin < seconds * 1000) {
+    int n = epoll_wait(epfd, events.data(), events.size(), 1);
+    for (int i = 0; i < n; i++) {
+      Plant *p = (Plant *)events[i].data.ptr;
+      if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+        p->writable();
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+        p->readable();
+    }
+
+    uint32_t now = millis();
+    if (now != lastRun) {
+      lastRun = now;
+      for (uint32_t i = 0; i < plants.size(); i++)
+        plants[i]->run(i, now);
+    }
+
+    if (due(now, nextStorm)) {
+      nextStorm += compressed(STORM_MS);
+      for (Plant *p : plants)
+        p->drop();
+      for (Plant *p : plants)
+        p->start();
+    }
+
+    // what the events and timers queued, one send per plant
+    std::vector<Plant *> sending;
+    sending.swap(pendingTx);
+    for (Plant *p : sending)
+      p->flush();
+
+    if (due(now, nextReport)) {
+      nextReport += REPORT_MS;
+      report(now - reportStart);
+      reportStart = now;
+    }
+  }
+
+  report(millis() - reportStart);
+  for (Plant *p : plants)
+    p->drop();
+  return 0;
+}
@@ -0,0 +1,28 @@
+// Prints the sketch's log from the serial port:
+//
+//   stty -F /dev/ttyACM0 raw && build/mqtt-log-decode < /dev/ttyACM0
+//
+// Log records become lines of text; anything else the firmware prints
+// comes through as it is.
+
+#include "log-events.h"
+#include "mqtt-log-decoder.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+static const char *const sketchFormats[] = { LOG_EVENT_FORMATS };
+
+int main() {
+  LogDecoder decoder(sketchFormats, sizeof(sketchFormats) / sizeof(sketchFormats[0]));
+  decoder.onRecord = [&](const LogRecord &r) { printf("%s\n", decoder.text(r).c_str()); };
+  decoder.onOther = [](char c) { putchar(c); };
+
+  uint8_t buf[512];
+  ssize_t n;
+  while ((n = read(0, buf, sizeof(buf))) > 0) {
+    decoder.feed(buf, n);
+    fflush(stdout);
+  }
+  return 0;
+}
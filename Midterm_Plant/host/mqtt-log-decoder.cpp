@@ -0,0 +1,83 @@
+#include "mqtt-log-decoder.h"
+
+#include "Adafruit_MQTT_Log.h"
+
+#include <cstdio>
+
+static const char *const libraryFormats[] = { MQTT_LOG_LIBRARY_FORMATS };
+static_assert(sizeof(libraryFormats) / sizeof(libraryFormats[0]) == MQTT_LOG_LIBRARY_EVENTS,
+              "a format for every library event");
+
+static uint32_t little32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+LogDecoder::LogDecoder(const char *const *userFormats, uint8_t userCount)
+    : userFormats(userFormats), userCount(userCount) {}
+
+void LogDecoder::feed(const uint8_t *data, size_t len) {
+  pending.insert(pending.end(), data, data + len);
+
+  size_t i = 0;
+  while (i < pending.size()) {
+    const uint8_t *p = &pending[i];
+    size_t left = pending.size() - i;
+    if (p[0] != MQTT_LOG_SYNC) {
+      if (onOther)
+        onOther(p[0]);
+      i++;
+      continue;
+    }
+    // wait for the rest of a record that's split across reads
+    if (left < 3)
+      break;
+    uint8_t argc = p[2];
+    size_t recordLen = 3 + 4 + 4 * argc + 1;
+    if (argc <= MQTT_LOG_MAXARGS && left < recordLen)
+      break;
+
+    uint8_t sum = 0;
+    for (size_t j = 1; argc <= MQTT_LOG_MAXARGS && j < recordLen - 1; j++)
+      sum += p[j];
+    if (argc > MQTT_LOG_MAXARGS || sum != p[recordLen - 1]) {
+      // a sync byte that doesn't start a record
+      if (onOther)
+        onOther(p[0]);
+      i++;
+      continue;
+    }
+
+    LogRecord r = {};
+    r.id = p[1];
+    r.argc = argc;
+    r.ms = little32(p + 3);
+    for (uint8_t a = 0; a < argc; a++)
+      r.args[a] = (int32_t)little32(p + 7 + 4 * a);
+    if (onRecord)
+      onRecord(r);
+    i += recordLen;
+  }
+  pending.erase(pending.begin(), pending.begin() + i);
+}
+
+const char *LogDecoder::format(uint8_t id) const {
+  if (id < MQTT_LOG_LIBRARY_EVENTS)
+    return libraryFormats[id];
+  if (id >= MQTT_LOG_USER && id - MQTT_LOG_USER < userCount)
+    return userFormats[id - MQTT_LOG_USER];
+  return NULL;
+}
+
+std::string LogDecoder::text(const LogRecord &r) const {
+  char line[256];
+  int n = snprintf(line, sizeof(line), "[%lu] ", (unsigned long)r.ms);
+  const char *fmt = format(r.id);
+  if (fmt) {
+    snprintf(line + n, sizeof(line) - n, fmt, (long)r.args[0], (long)r.args[1], (long)r.args[2]);
+  } else {
+    n += snprintf(line + n, sizeof(line) - n, "event %u", r.id);
+    for (uint8_t a = 0; a < r.argc; a++)
+      n += snprintf(line + n, sizeof(line) - n, " %ld", (long)r.args[a]);
+  }
+  return line;
+}
@@ -0,0 +1,42 @@
+#ifndef MQTT_LOG_DECODER_H
+#define MQTT_LOG_DECODER_H
+
+// Turns the records Adafruit_MQTT_Log::drain() writes back into text.
+// Works on a byte stream as read from the serial port: records can arrive
+// split across reads, and anything else on the port is passed through.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct LogRecord {
+  uint32_t ms;
+  uint8_t id;
+  uint8_t argc;
+  int32_t args[3];
+};
+
+class LogDecoder {
+ public:
+  // userFormats are the application's, for ids MQTT_LOG_USER and up.
+  LogDecoder(const char *const *userFormats = NULL, uint8_t userCount = 0);
+
+  void feed(const uint8_t *data, size_t len);
+  // "[ms] text", as the device used to print it
+  std::string text(const LogRecord &r) const;
+
+  std::function<void(const LogRecord &)> onRecord;
+  // bytes that aren't part of a record, in order
+  std::function<void(char)> onOther;
+
+ private:
+  const char *format(uint8_t id) const;
+
+  const char *const *userFormats;
+  uint8_t userCount;
+  std::vector<uint8_t> pending;
+};
+
+#endif
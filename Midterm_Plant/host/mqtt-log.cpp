@@ -0,0 +1,153 @@
+// Adafruit_MQTT_Log round trip: events into the ring, drain() into a port
+// with limited room, the bytes back through the host decoder.  Every event
+// must come out with its id, arguments and timestamp and render to the
+// sketch's or library's text; drain() must only write whole records that
+// fit, report events lost to a full ring, and the decoder must cope with
+// records split across reads, other output on the port and corruption.
+
+#include "Adafruit_MQTT_Log.h"
+#include "mqtt-log-decoder.h"
+#include "log-events.h"
+
+static const char *const sketchFormats[] = { LOG_EVENT_FORMATS };
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+// what the serial port received
+class CapturePort : public Print {
+ public:
+  using Print::write;
+  size_t write(uint8_t c) override { bytes.push_back(c); return 1; }
+  std::vector<uint8_t> bytes;
+};
+
+struct Logged {
+  uint8_t id;
+  uint8_t argc;
+  int32_t args[3];
+  const char *text;
+};
+
+static const Logged events[] = {
+  { MQTT_LOG_THROTTLED, 1, { 23000 }, "MQTT: throttled by broker, pausing publishes 23000 ms" },
+  { MQTT_LOG_CONNECT_FAILED, 2, { 1, -4 }, "MQTT: broker 1 connect failed, error -4" },
+  { LOG_BME_FAILED, 1, { 0x76 }, "BME280 at address 0x76 failed to start" },
+  { LOG_PUMP_WEB, 3, { 1800, 2400, 3 }, "Watering from the web, 1800 us after receipt (p99 2400 us, 3 over SLO)" },
+  { MQTT_LOG_DEAD_LINK, 3, { 0, 350, 120 }, "MQTT: broker 0 dead link (rtt 350 ms, var 120 ms), disconnecting" },
+  { 40, 0, {}, "event 40" },
+  { LOG_PUMP_AUTO, 1, { INT32_MIN }, "Watering, moisture -2147483648" },
+};
+static const uint8_t eventCount = sizeof(events) / sizeof(events[0]);
+
+static void logEvent(const Logged &e) {
+  switch (e.argc) {
+    case 0: mqttLog.log(e.id); break;
+    case 1: mqttLog.log(e.id, e.args[0]); break;
+    case 2: mqttLog.log(e.id, e.args[0], e.args[1]); break;
+    default: mqttLog.log(e.id, e.args[0], e.args[1], e.args[2]); break;
+  }
+}
+
+static bool same(const LogRecord &r, const Logged &e) {
+  if (r.id != e.id || r.argc != e.argc)
+    return false;
+  for (uint8_t a = 0; a < e.argc; a++)
+    if (r.args[a] != e.args[a])
+      return false;
+  return true;
+}
+
+int main() {
+  LogDecoder decoder(sketchFormats, sizeof(sketchFormats) / sizeof(sketchFormats[0]));
+  std::vector<LogRecord> records;
+  std::string other;
+  decoder.onRecord = [&](const LogRecord &r) { records.push_back(r); };
+  decoder.onOther = [&](char c) { other += c; };
+
+  CapturePort port;
+  // a timestamp with every byte different, to catch byte order mistakes
+  advanceClock(0x12345678);
+  uint32_t before = millis();
+  for (const Logged &e : events)
+    logEvent(e);
+  uint32_t after = millis();
+  check(mqttLog.pending() == eventCount, "all events queued");
+
+  // only whole records, and only when they fit
+  check(mqttLog.drain(port, 11) == 0 && port.bytes.empty(),
+        "nothing written when the first record doesn't fit");
+  check(mqttLog.drain(port, 12) == 1 && port.bytes.size() == 12,
+        "a one argument record is 12 bytes");
+  check(mqttLog.drain(port, 12 + 15) == 1 && port.bytes.size() == 12 + 16,
+        "a record that doesn't fit the rest of the room waits");
+  check(mqttLog.pending() == eventCount - 2, "undrained events stay queued");
+
+  // the sketch printing something between drains
+  const char *note = "pump on\r\n";
+  port.write((const uint8_t *)note, strlen(note));
+  check(mqttLog.drain(port, 1000) == eventCount - 2 && mqttLog.pending() == 0, "the rest drained");
+
+  // one byte at a time, so every record is split across reads
+  for (uint8_t b : port.bytes)
+    decoder.feed(&b, 1);
+  check(records.size() == eventCount, "every event decoded");
+  check(other == note, "other output passed through");
+
+  size_t textBytes = 0;
+  for (uint8_t i = 0; i < eventCount && i < records.size(); i++) {
+    const LogRecord &r = records[i];
+    char expected[160];
+    snprintf(expected, sizeof(expected), "[%u] %s", (unsigned)r.ms, events[i].text);
+    textBytes += strlen(expected) + 2;
+    if (!same(r, events[i]) || r.ms - before > after - before ||
+        decoder.text(r) != expected) {
+      printf("event %u: got \"%s\"\n", i, decoder.text(r).c_str());
+      check(false, "event round trip");
+    }
+  }
+  printf("%u events: %u bytes of records, %u bytes as text\n", eventCount,
+         (unsigned)(port.bytes.size() - strlen(note)), (unsigned)textBytes);
+
+  // a corrupted record is passed through and the decoder finds the next one
+  std::vector<uint8_t> wire = port.bytes;
+  wire[1] ^= 0x01;
+  records.clear();
+  other.clear();
+  decoder.feed(wire.data(), wire.size());
+  check(records.size() == eventCount - 1 && same(records[0], events[1]),
+        "resynced after a corrupt record");
+  check(other.size() == 12 + strlen(note), "corrupt record passed through");
+
+  // a full ring: the overflow is reported ahead of what was kept
+  uint32_t droppedBefore = mqttLog.dropped();
+  for (uint8_t i = 0; i < MQTT_LOG_EVENTS + 9; i++)
+    mqttLog.log(LOG_PUMP_AUTO, i);
+  check(mqttLog.dropped() - droppedBefore == 10, "events beyond the ring counted as dropped");
+  port.bytes.clear();
+  records.clear();
+  while (mqttLog.pending())
+    mqttLog.drain(port, 64);
+  decoder.feed(port.bytes.data(), port.bytes.size());
+  check(records.size() == MQTT_LOG_EVENTS && records[0].id == MQTT_LOG_EVENTS_DROPPED &&
+        records[0].args[0] == 10, "dropped events reported first");
+  if (!records.empty())
+    check(decoder.text(records[0]).find("] log: 10 events dropped") != std::string::npos,
+          "dropped report text");
+  check(records.size() > 1 && records[1].args[0] == 0 &&
+        records.back().args[0] == MQTT_LOG_EVENTS - 2, "the oldest events were kept");
+  port.bytes.clear();
+  mqttLog.drain(port, 64);
+  check(port.bytes.empty(), "dropped events reported once");
+
+  if (failures)
+    return 1;
+  printf("log: ring, drain and decode agree, including overflow and corruption\n");
+  return 0;
+}
@@ -0,0 +1,48 @@
+// Publishes echoed by the loopback broker, across the size where the
+// remaining length needs a second byte: every payload that fits the
+// client's buffer has to come back through readSubscription() with the
+// right topic and data, and a QoS 1 one with its PUBACK as well.
+
+#include "Adafruit_MQTT_Loopback.h"
+
+#include <string>
+
+static const char ECHO_TOPIC[] = "user/feeds/echo";
+
+int main() {
+  Adafruit_MQTT_Loopback mqtt("loopback-test", "user", "key");
+  Adafruit_MQTT_Subscribe echoSub(&mqtt, ECHO_TOPIC);
+  mqtt.subscribe(&echoSub);
+  if (mqtt.connect() != 0) {
+    printf("FAILED: connect\n");
+    return 1;
+  }
+
+  // fixed header, at most two remaining length bytes, topic, packet id
+  uint16_t longest = MAXBUFFERSIZE - 3 - 2 - strlen(ECHO_TOPIC) - 2;
+  uint32_t failures = 0;
+  for (uint8_t qos = 0; qos <= 1; qos++) {
+    for (uint16_t len = 0; len <= longest; len++) {
+      std::string payload;
+      for (uint16_t i = 0; i < len; i++)
+        payload += (char)('a' + (i + len) % 26);
+      // readSubscription() keeps up to SUBSCRIPTIONDATALEN bytes, a longer
+      // payload is cut to leave room for a terminator
+      uint16_t expected = len <= SUBSCRIPTIONDATALEN ? len : SUBSCRIPTIONDATALEN - 1;
+
+      bool sent = mqtt.publish(ECHO_TOPIC, (uint8_t *)payload.data(), len, qos);
+      Adafruit_MQTT_Subscribe *got = mqtt.readSubscription(100);
+      if (!sent || got != &echoSub || echoSub.datalen != expected ||
+          memcmp(echoSub.lastread, payload.data(), expected) != 0) {
+        printf("FAILED: QoS %u, %u byte payload: %s\n", qos, len,
+               !sent ? "publish failed" : got != &echoSub ? "no echo" : "payload differs");
+        failures++;
+      }
+    }
+  }
+
+  if (failures)
+    return 1;
+  printf("loopback: payloads 0 to %u bytes echoed at QoS 0 and 1\n", longest);
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Adafruit_MQTT_PublishPolicy on the stub clock, with the sketch's 15 s
+// samples: the deadband, the minimum interval, the heartbeat, force() and
+// the rate trigger.  The rate trigger has to fire on a change that's still
+// inside the deadband, or it never adds anything: with a 50 count deadband
+// that needs less than 50 counts per sample, under 3.3 counts/s.
+
+#include "Adafruit_MQTT_PublishPolicy.h"
+#include "recording-mqtt.h"
+
+static const uint32_t SAMPLE_MS = 15000;
+
+static RecordingMQTT mqtt;
+static Adafruit_MQTT_Publish feed(&mqtt, "user/feeds/soilmoisture");
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+// the next sample, SAMPLE_MS after the last one
+static bool sample(Adafruit_MQTT_PublishPolicy &policy, int value, uint32_t after = SAMPLE_MS) {
+  advanceClock(after);
+  uint32_t before = mqtt.packetsSent;
+  bool published = policy.update(value);
+  check(published == (mqtt.packetsSent != before), "update() reports what went out");
+  return published;
+}
+
+int main() {
+  {
+    Adafruit_MQTT_PublishPolicy policy(&feed, SAMPLE_MS, 0);
+    policy.setDeadband(50);
+    check(sample(policy, 1800), "first sample published");
+    check(!sample(policy, 1840), "inside the deadband");
+    check(!sample(policy, 1850), "on the edge of the deadband");
+    check(sample(policy, 1851), "outside the deadband");
+    check(!sample(policy, 1805), "deadband is around the last published value");
+    check(policy.publishedCount() == 2 && policy.suppressedCount() == 3, "counts");
+  }
+  {
+    Adafruit_MQTT_PublishPolicy policy(&feed, SAMPLE_MS, 0);
+    policy.setDeadband(0.10, true);
+    check(sample(policy, 100), "first sample published");
+    check(!sample(policy, 109), "inside a 10% deadband");
+    check(sample(policy, 111), "outside a 10% deadband");
+  }
+  {
+    Adafruit_MQTT_PublishPolicy policy(&feed, SAMPLE_MS, 0);
+    check(sample(policy, 1), "first sample published");
+    check(!sample(policy, 2, 5000), "held back by the minimum interval");
+    check(sample(policy, 3, 10000), "published once the minimum interval is up");
+    policy.force();
+    check(!sample(policy, 3, 5000), "force() still waits out the minimum interval");
+    check(sample(policy, 3, 10000), "force() publishes an unchanged value");
+    check(!sample(policy, 3), "force() is one sample only");
+  }
+  {
+    Adafruit_MQTT_PublishPolicy policy(&feed, SAMPLE_MS, 600000);
+    policy.setDeadband(50);
+    check(sample(policy, 1800), "first sample published");
+    uint8_t quiet = 0;
+    while (quiet < 100 && !sample(policy, 1800))
+      quiet++;
+    check(quiet == 600000 / SAMPLE_MS - 1, "heartbeat after the maximum interval");
+  }
+  {
+    // the sketch's moisture feed
+    Adafruit_MQTT_PublishPolicy policy(&feed, SAMPLE_MS, 600000);
+    policy.setDeadband(50);
+    policy.setRateTrigger(2);
+    check(sample(policy, 1800), "first sample published");
+    check(!sample(policy, 1810), "slow change");
+    check(!sample(policy, 1785), "25 counts in a sample is under 2 counts/s");
+    check(sample(policy, 1750), "35 counts in a sample, inside the deadband, fires the rate trigger");
+  }
+  {
+    // the old setting: 10 counts/s is 150 counts a sample, the deadband
+    // always gets there first
+    Adafruit_MQTT_PublishPolicy policy(&feed, SAMPLE_MS, 600000);
+    policy.setDeadband(50);
+    policy.setRateTrigger(10);
+    check(sample(policy, 1800), "first sample published");
+    check(!sample(policy, 1850) && !sample(policy, 1800) && !sample(policy, 1850),
+          "10 counts/s never fires inside a 50 count deadband");
+  }
+
+  if (failures)
+    return 1;
+  printf("publish policy: deadband, intervals, force and rate trigger\n");
+  return 0;
+}
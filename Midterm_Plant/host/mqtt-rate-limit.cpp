@@ -0,0 +1,75 @@
+// The publish rate limiter and the broker's throttle over long uptimes.
+// millis() is a 32 bit counter: past 2^31 ms (24.8 days) a deadline that
+// was never set looks like it's still ahead, and one set just before the
+// counter wraps looks long gone.  The stub clock is moved forward to both.
+
+#include "recording-mqtt.h"
+
+static RecordingMQTT mqtt;
+static Adafruit_MQTT_Subscribe throttleFeed(&mqtt, "user/throttle");
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED at millis() %lu: %s\n", millis(), what);
+    failures++;
+  }
+}
+
+// whether a QoS 0 publish goes out now rather than being deferred
+static bool publishes() {
+  uint32_t before = mqtt.packetsSent;
+  mqtt.publish("user/feeds/planttemp", "71.3");
+  return mqtt.packetsSent != before;
+}
+
+static void throttle(const char *message) {
+  mqtt.deliver("user/throttle", message);
+  check(mqtt.readSubscription(0) == &throttleFeed, "throttle message read");
+}
+
+static void moveClockTo(uint32_t ms) {
+  advanceClock(ms - (uint32_t)millis());
+}
+
+int main() {
+  mqtt.subscribe(&throttleFeed);
+  mqtt.setThrottleFeed(&throttleFeed);
+  mqtt.setRateLimit(30, 5);
+
+  check(publishes(), "publish right after boot");
+
+  // 24.8 days up, no throttle ever sent
+  moveClockTo(0x80000000UL + 1000);
+  check(!mqtt.throttled(), "not throttled past 2^31 ms");
+  check(publishes(), "publish past 2^31 ms");
+
+  // a throttle still holds publishes back for as long as it says
+  throttle("user data rate limit reached, 23 seconds until throttle released");
+  check(mqtt.throttled(), "throttled after the broker says so");
+  check(!publishes(), "publish deferred while throttled");
+  advanceClock(22000);
+  check(!publishes(), "publish deferred a second before the throttle ends");
+  advanceClock(5000);
+  check(!mqtt.throttled(), "throttle over");
+  check(publishes(), "publish after the throttle");
+
+  // and across the counter wrapping
+  moveClockTo(0xFFFFFFFFUL - 10000);
+  throttle("user data rate limit reached, 23 seconds until throttle released");
+  advanceClock(20000);
+  check(mqtt.throttled(), "throttled across the wrap");
+  check(!publishes(), "publish deferred across the wrap");
+  advanceClock(5000);
+  check(publishes(), "publish after a throttle that ended past the wrap");
+
+  // the next 24.8 days, when a deadline left over from above looks ahead
+  moveClockTo(millis() + 0x80000000UL);
+  check(!mqtt.throttled(), "not throttled 2^31 ms after the last throttle");
+  check(publishes(), "publish 2^31 ms after the last throttle");
+
+  if (failures)
+    return 1;
+  printf("rate limit: only the broker throttles publishes, past 2^31 ms and across the wrap\n");
+  return 0;
+}
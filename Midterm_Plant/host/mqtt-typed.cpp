@@ -0,0 +1,60 @@
+// The typed payload parsers on edge cases, built with the undefined
+// behaviour sanitizer: a fixed point payload whose whole part overflows
+// int64 once it's scaled has to be rejected like any other bad payload,
+// not wrapped, and a typed subscription keeps its last good value.
+
+#include "Adafruit_MQTT_Typed.h"
+#include "recording-mqtt.h"
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+static bool fixed(const char *s, uint8_t decimals, int64_t expected) {
+  int64_t v = 0;
+  return mqttParseFixed((const uint8_t *)s, strlen(s), decimals, v) && v == expected;
+}
+
+static bool rejected(const char *s, uint8_t decimals) {
+  int64_t v = 0;
+  return !mqttParseFixed((const uint8_t *)s, strlen(s), decimals, v);
+}
+
+int main() {
+  check(fixed("21.5", 2, 2150), "21.5");
+  check(fixed("-0.5", 2, -50), "-0.5");
+  check(fixed(".25", 2, 25), ".25");
+  check(fixed("1.999", 2, 199), "extra digits truncated");
+  check(fixed("92233720368547758.07", 2, INT64_MAX), "largest value that fits");
+  check(fixed("-92233720368547758.07", 2, -INT64_MAX), "most negative value allowed");
+  check(fixed("1", 18, 1000000000000000000LL), "18 decimals");
+
+  check(rejected("92233720368547758.08", 2), "one past the largest value");
+  check(rejected("-92233720368547758.08", 2), "one past the most negative value");
+  check(rejected("999999999999999999", 2), "18 digit whole part, scaled");
+  check(rejected("-999999999999999999.9", 1), "negative, scaled");
+  check(rejected("9.5", 18), "whole part overflows at 18 decimals");
+  check(rejected("1", 19), "more decimals than int64 holds");
+  check(rejected("12.", 2) && rejected("-", 2) && rejected("1.2x", 2), "malformed");
+
+  // through a subscription, where the payload comes from the broker
+  RecordingMQTT mqtt;
+  Adafruit_MQTT_TypedSubscribe<Adafruit_MQTT_Fixed<2> > setpoint(&mqtt, "user/feeds/setpoint");
+  mqtt.subscribe(&setpoint);
+  mqtt.deliver("user/feeds/setpoint", "21.5");
+  check(mqtt.readSubscription(0) == &setpoint && setpoint.valid() &&
+        setpoint.value().raw == 2150, "good payload");
+  mqtt.deliver("user/feeds/setpoint", "999999999999999999");
+  check(mqtt.readSubscription(0) == &setpoint && !setpoint.valid() &&
+        setpoint.value().raw == 2150, "oversized payload rejected, last value kept");
+
+  if (failures)
+    return 1;
+  printf("typed: fixed point parsing rejects what doesn't fit\n");
+  return 0;
+}
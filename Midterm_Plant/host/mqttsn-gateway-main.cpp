@@ -0,0 +1,45 @@
+// The gateway stand-in on its own, for a real node on the network:
+//
+//   mqttsn-gateway [port] [id=topic ...]
+//
+// e.g. mqttsn-gateway 10000 1=user/feeds/soilmoisture 2=user/feeds/turnonpump
+// for the mqttsn-sleepy-node example.  Prints what the nodes publish; a
+// "<topic> <payload>" line on stdin is sent to the nodes subscribed to it.
+
+#include "mqttsn-gateway.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv) {
+  MQTTSNGateway gateway;
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+      fprintf(stderr, "usage: %s [port] [id=topic ...]\n", argv[0]);
+      return 2;
+    }
+    gateway.predefine(strtoul(arg.c_str(), NULL, 10), arg.substr(eq + 1));
+  }
+  gateway.onPublish = [](const MQTTSNGateway::Message &m) {
+    printf("%s QoS %d, %u bytes: %s %s\n", m.client.empty() ? "(no session)" : m.client.c_str(),
+           m.qos, m.datagram, m.topic.c_str(), m.payload.c_str());
+    fflush(stdout);
+  };
+  if (!gateway.start(argc > 1 ? strtoul(argv[1], NULL, 10) : 10000, true)) {
+    perror("mqttsn-gateway");
+    return 1;
+  }
+  printf("MQTT-SN gateway on UDP port %u\n", gateway.port());
+  fflush(stdout);
+
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    size_t space = line.find(' ');
+    if (space != std::string::npos)
+      gateway.publish(line.substr(0, space), line.substr(space + 1));
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+#include "mqttsn-gateway.h"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Written from the MQTT-SN v1.2 spec rather than Adafruit_MQTTSN.h, so the
+// client's encoding is checked against something it didn't produce.
+enum {
+  CONNECT = 0x04, CONNACK = 0x05, REGISTER = 0x0A, REGACK = 0x0B,
+  PUBLISH = 0x0C, PUBACK = 0x0D, SUBSCRIBE = 0x12, SUBACK = 0x13,
+  PINGREQ = 0x16, PINGRESP = 0x17, DISCONNECT = 0x18,
+};
+enum { ACCEPTED = 0, INVALID_TOPIC_ID = 2 };
+enum { TOPIC_NORMAL = 0, TOPIC_PREDEFINED = 1 };
+
+static uint64_t key(const sockaddr_in &addr) {
+  return (uint64_t)addr.sin_addr.s_addr << 16 | addr.sin_port;
+}
+
+MQTTSNGateway::MQTTSNGateway()
+    : fd(-1), localPort(0), running(false), registerCount(0), msgIdCounter(0) {}
+
+MQTTSNGateway::~MQTTSNGateway() {
+  running = false;
+  if (thread.joinable())
+    thread.join();
+  if (fd >= 0)
+    close(fd);
+}
+
+bool MQTTSNGateway::start(uint16_t port, bool anyAddress) {
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(anyAddress ? INADDR_ANY : INADDR_LOOPBACK);
+  local.sin_port = htons(port);
+  socklen_t len = sizeof(local);
+  if (fd < 0 || bind(fd, (sockaddr *)&local, len) < 0 ||
+      getsockname(fd, (sockaddr *)&local, &len) < 0)
+    return false;
+  localPort = ntohs(local.sin_port);
+  running = true;
+  thread = std::thread(&MQTTSNGateway::serve, this);
+  return true;
+}
+
+void MQTTSNGateway::serve() {
+  while (running) {
+    pollfd waiting = { fd, POLLIN, 0 };
+    if (poll(&waiting, 1, 20) <= 0)
+      continue;
+    uint8_t packet[256];
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(fd, packet, sizeof(packet), 0, (sockaddr *)&from, &fromLen);
+    // one byte length only, matching the datagram
+    if (n < 2 || packet[0] != n)
+      continue;
+    std::lock_guard<std::mutex> guard(lock);
+    handle(packet, n, from);
+  }
+}
+
+void MQTTSNGateway::handle(const uint8_t *p, uint8_t len, const sockaddr_in &from) {
+  auto found = sessions.find(key(from));
+  Session *session = found == sessions.end() ? NULL : &found->second;
+
+  switch (p[1]) {
+    case CONNECT: {
+      if (len < 6)
+        return;
+      // always a clean session
+      Session fresh;
+      fresh.client.assign((const char *)p + 6, len - 6);
+      fresh.addr = from;
+      sessions[key(from)] = fresh;
+      send(from, { 3, CONNACK, ACCEPTED });
+      break;
+    }
+
+    case REGISTER: {
+      if (!session || len < 7)
+        return;
+      uint16_t topicId = session->nextTopicId++;
+      session->registered[topicId].assign((const char *)p + 6, len - 6);
+      registerCount++;
+      send(from, { 7, REGACK, (uint8_t)(topicId >> 8), (uint8_t)topicId, p[4], p[5], ACCEPTED });
+      break;
+    }
+
+    case PUBLISH:
+      accept(session, p, len);
+      break;
+
+    case SUBSCRIBE: {
+      if (!session || len < 7 || (p[2] & 0x03) != TOPIC_PREDEFINED)
+        return;
+      uint16_t topicId = p[5] << 8 | p[6];
+      uint8_t qos = (p[2] >> 5) & 0x03;
+      uint8_t rc = INVALID_TOPIC_ID;
+      if (predefined.count(topicId)) {
+        session->subscribed[predefined[topicId]] = qos;
+        rc = ACCEPTED;
+      }
+      send(from, { 8, SUBACK, (uint8_t)(qos << 5), p[5], p[6], p[3], p[4], rc });
+      break;
+    }
+
+    case PINGREQ:
+      // a PINGREQ from a client nobody knows gets no answer
+      if (!session)
+        return;
+      // with a client id: a sleeping node collecting what was held for it
+      if (len > 2 && session->asleep) {
+        for (const std::vector<uint8_t> &held : session->held)
+          send(from, held);
+        session->held.clear();
+      }
+      send(from, { 2, PINGRESP });
+      break;
+
+    case DISCONNECT:
+      if (!session)
+        return;
+      // with a duration it's going to sleep, otherwise it's gone
+      if (len == 4)
+        session->asleep = true;
+      else
+        sessions.erase(key(from));
+      send(from, { 2, DISCONNECT });
+      break;
+  }
+}
+
+void MQTTSNGateway::accept(Session *session, const uint8_t *p, uint8_t len) {
+  if (len < 7)
+    return;
+  uint8_t qosBits = (p[2] >> 5) & 0x03;
+  int8_t qos = qosBits == 3 ? -1 : qosBits;
+  uint8_t topicType = p[2] & 0x03;
+  uint16_t topicId = p[3] << 8 | p[4];
+
+  // QoS -1 is the only thing a node without a session can send, and only
+  // to a predefined topic
+  if (!session && (qos >= 0 || topicType != TOPIC_PREDEFINED))
+    return;
+
+  std::string topic;
+  if (topicType == TOPIC_PREDEFINED && predefined.count(topicId))
+    topic = predefined[topicId];
+  else if (topicType == TOPIC_NORMAL && session->registered.count(topicId))
+    topic = session->registered[topicId];
+
+  if (qos == 1)
+    send(session->addr, { 7, PUBACK, p[3], p[4], p[5], p[6],
+                          (uint8_t)(topic.empty() ? INVALID_TOPIC_ID : ACCEPTED) });
+  if (topic.empty())
+    return;
+
+  Message m;
+  m.client = session ? session->client : "";
+  m.topic = topic;
+  m.payload.assign((const char *)p + 7, len - 7);
+  m.qos = qos;
+  m.datagram = len;
+  messages.push_back(m);
+  if (onPublish)
+    onPublish(m);
+  deliver(topic, m.payload, qos < 0 ? 0 : qos);
+}
+
+void MQTTSNGateway::deliver(const std::string &topic, const std::string &payload, uint8_t qos) {
+  uint16_t topicId = 0;
+  for (auto &entry : predefined)
+    if (entry.second == topic)
+      topicId = entry.first;
+
+  for (auto &entry : sessions) {
+    Session &s = entry.second;
+    auto sub = s.subscribed.find(topic);
+    if (sub == s.subscribed.end())
+      continue;
+    uint8_t q = qos < sub->second ? qos : sub->second;
+    uint16_t msgId = q ? ++msgIdCounter : 0;
+    std::vector<uint8_t> packet = { (uint8_t)(7 + payload.size()), PUBLISH,
+                                    (uint8_t)(q << 5 | TOPIC_PREDEFINED),
+                                    (uint8_t)(topicId >> 8), (uint8_t)topicId,
+                                    (uint8_t)(msgId >> 8), (uint8_t)msgId };
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    if (s.asleep)
+      s.held.push_back(packet);
+    else
+      send(s.addr, packet);
+  }
+}
+
+void MQTTSNGateway::send(const sockaddr_in &to, const std::vector<uint8_t> &packet) {
+  sendto(fd, packet.data(), packet.size(), 0, (const sockaddr *)&to, sizeof(to));
+}
+
+MQTTSNGateway::Session *MQTTSNGateway::find(const std::string &client) {
+  for (auto &entry : sessions)
+    if (entry.second.client == client)
+      return &entry.second;
+  return NULL;
+}
+
+void MQTTSNGateway::predefine(uint16_t topicId, const std::string &topic) {
+  std::lock_guard<std::mutex> guard(lock);
+  predefined[topicId] = topic;
+}
+
+void MQTTSNGateway::publish(const std::string &topic, const std::string &payload, uint8_t qos) {
+  std::lock_guard<std::mutex> guard(lock);
+  deliver(topic, payload, qos);
+}
+
+void MQTTSNGateway::forget() {
+  std::lock_guard<std::mutex> guard(lock);
+  sessions.clear();
+}
+
+std::vector<MQTTSNGateway::Message> MQTTSNGateway::received() {
+  std::lock_guard<std::mutex> guard(lock);
+  return messages;
+}
+
+uint32_t MQTTSNGateway::registrations() {
+  std::lock_guard<std::mutex> guard(lock);
+  return registerCount;
+}
+
+bool MQTTSNGateway::connected(const std::string &client) {
+  std::lock_guard<std::mutex> guard(lock);
+  Session *s = find(client);
+  return s && !s->asleep;
+}
+
+bool MQTTSNGateway::asleep(const std::string &client) {
+  std::lock_guard<std::mutex> guard(lock);
+  Session *s = find(client);
+  return s && s->asleep;
+}
@@ -0,0 +1,79 @@
+// A stand-in for an MQTT-SN gateway (the Paho one, say) on a PC, to test
+// Adafruit_MQTTSN against.  Speaks MQTT-SN v1.2 over UDP on its own thread
+// and is its own broker: publishes are recorded and passed on to the nodes
+// subscribed to the topic, held for sleeping ones until they wake.
+// publish() injects a message as if it came from the broker.
+//
+// Sessions are kept per address and forgotten on forget(), as a gateway
+// restart does.  QoS 1 messages to nodes aren't retried.
+#pragma once
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MQTTSNGateway {
+ public:
+  struct Message {
+    std::string client;   // empty for QoS -1 from a node with no session
+    std::string topic;
+    std::string payload;
+    int8_t qos;
+    uint8_t datagram;     // bytes on the wire
+  };
+
+  MQTTSNGateway();
+  ~MQTTSNGateway();
+
+  // Listens on port, 0 for any free one, on loopback unless anyAddress.
+  bool start(uint16_t port = 0, bool anyAddress = false);
+  uint16_t port() { return localPort; }
+
+  void predefine(uint16_t topicId, const std::string &topic);
+  void publish(const std::string &topic, const std::string &payload, uint8_t qos = 1);
+  void forget();
+
+  std::vector<Message> received();
+  uint32_t registrations();
+  bool connected(const std::string &client);
+  bool asleep(const std::string &client);
+
+  // Called on the gateway's thread for every publish it accepts.
+  std::function<void(const Message &)> onPublish;
+
+ private:
+  struct Session {
+    std::string client;
+    sockaddr_in addr;
+    bool asleep = false;
+    uint16_t nextTopicId = 0x100;
+    std::map<uint16_t, std::string> registered;
+    std::map<std::string, uint8_t> subscribed;   // topic, QoS
+    std::vector<std::vector<uint8_t>> held;
+  };
+
+  int fd;
+  uint16_t localPort;
+  bool running;
+  std::thread thread;
+  std::mutex lock;
+
+  std::map<uint16_t, std::string> predefined;
+  std::map<uint64_t, Session> sessions;
+  std::vector<Message> messages;
+  uint32_t registerCount;
+  uint16_t msgIdCounter;
+
+  void serve();
+  void handle(const uint8_t *packet, uint8_t len, const sockaddr_in &from);
+  void accept(Session *session, const uint8_t *packet, uint8_t len);
+  void deliver(const std::string &topic, const std::string &payload, uint8_t qos);
+  void send(const sockaddr_in &to, const std::vector<uint8_t> &packet);
+  Session *find(const std::string &client);
+};
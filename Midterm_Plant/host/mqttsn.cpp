@@ -0,0 +1,150 @@
+// Adafruit_MQTTSN against the gateway stand-in over real UDP on loopback:
+// QoS -1 with no connection, CONNECT, QoS 0 and 1 on predefined topic ids,
+// REGISTER and publish by name, delivery to a node that's awake and one
+// that's asleep, and the sleepy node's cycle when the gateway restarts and
+// forgets it: wake() goes unanswered, the node registers again and its
+// topic names are registered again in the new session.
+
+#include "Adafruit_MQTTSN.h"
+#include "mqttsn-gateway.h"
+#include "recording-mqtt.h"
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const char MOISTURE_TOPIC[] = "user/feeds/soilmoisture";
+static const char PUMP_TOPIC[] = "user/feeds/turnonpump";
+static const char HUMID_TOPIC[] = "user/feeds/planthumid";
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+// a port nothing is bound to, for the node's end
+static uint16_t freePort() {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  socklen_t len = sizeof(addr);
+  bind(fd, (sockaddr *)&addr, len);
+  getsockname(fd, (sockaddr *)&addr, &len);
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+// The gateway works on its own thread; wait for it to have count messages.
+static std::vector<MQTTSNGateway::Message> waitForMessages(MQTTSNGateway &gateway, size_t count) {
+  std::vector<MQTTSNGateway::Message> got;
+  for (uint16_t i = 0; i < 200 && (got = gateway.received()).size() < count; i++)
+    delay(5);
+  return got;
+}
+
+static bool lastIs(const std::vector<MQTTSNGateway::Message> &got, const char *client,
+                   const char *topic, const char *payload, int8_t qos) {
+  if (got.empty())
+    return false;
+  const MQTTSNGateway::Message &m = got.back();
+  return m.client == client && m.topic == topic && m.payload == payload && m.qos == qos;
+}
+
+int main() {
+  MQTTSNGateway gateway;
+  gateway.predefine(1, MOISTURE_TOPIC);
+  gateway.predefine(2, PUMP_TOPIC);
+  if (!gateway.start()) {
+    perror("gateway");
+    return 1;
+  }
+
+  UDP udp;
+  Adafruit_MQTTSN node(&udp, IPAddress(127, 0, 0, 1), gateway.port(), "plant-node-1", freePort());
+  Adafruit_MQTTSN_Publish moistureM1(&node, 1, MQTTSN_QOS_M1);
+  Adafruit_MQTTSN_Publish moisture0(&node, 1, 0);
+  Adafruit_MQTTSN_Publish moisture1(&node, 1, 1);
+  Adafruit_MQTTSN_Publish humid(&node, HUMID_TOPIC, 1);
+  Adafruit_MQTTSN_Subscribe pump(&node, 2, 1);
+  node.subscribe(&pump);
+
+  // QoS -1: one datagram, no session
+  check(moistureM1.publish(1830), "QoS -1 publish without connecting");
+  std::vector<MQTTSNGateway::Message> got = waitForMessages(gateway, 1);
+  check(lastIs(got, "", MOISTURE_TOPIC, "1830", -1), "gateway got the QoS -1 publish");
+  uint8_t snBytes = got.empty() ? 0 : got.back().datagram;
+  check(!moisture0.publish(1830), "QoS 0 refused before connecting");
+  check(!humid.publish("40.2"), "publish by name refused before connecting");
+
+  // what the same sample costs over TCP
+  RecordingMQTT tcp;
+  tcp.publish(MOISTURE_TOPIC, "1830");
+  printf("QoS -1 moisture sample: %u byte datagram, %u byte MQTT PUBLISH\n",
+         snBytes, (unsigned)tcp.sent.size());
+  check(snBytes == 7 + 4, "QoS -1 publish is a 7 byte header and the payload");
+
+  check(node.connect() == 0, "connect");
+  check(node.connected() && gateway.connected("plant-node-1"), "session on both ends");
+
+  check(moisture0.publish(1829), "QoS 0 publish");
+  check(moisture1.publish(1828), "QoS 1 publish acknowledged");
+  got = waitForMessages(gateway, 3);
+  check(got.size() == 3 && got[1].qos == 0 && got[1].payload == "1829" &&
+        lastIs(got, "plant-node-1", MOISTURE_TOPIC, "1828", 1), "gateway got QoS 0 and 1");
+  check(!node.publish(999, (const uint8_t *)"1", 1, 1, MQTTSN_TOPIC_NORMAL),
+        "QoS 1 to a topic id the gateway never gave out is refused");
+  check(!node.publish(0x100, (const uint8_t *)"1", 1, MQTTSN_QOS_M1, MQTTSN_TOPIC_NORMAL),
+        "QoS -1 needs a predefined topic id");
+
+  // by name: REGISTER once, then the gateway's id
+  check(humid.publish("40.2"), "publish by name");
+  check(humid.publish("40.3"), "second publish by name");
+  got = waitForMessages(gateway, 5);
+  check(lastIs(got, "plant-node-1", HUMID_TOPIC, "40.3", 1), "gateway resolved the registered id");
+  check(gateway.registrations() == 1, "topic registered once per session");
+
+  // a pump command to a node that's awake
+  gateway.publish(PUMP_TOPIC, "1");
+  check(node.readSubscription(500) == &pump && strcmp((char *)pump.lastread, "1") == 0,
+        "pump command delivered while awake");
+
+  // asleep: the gateway holds it until wake()
+  check(node.sleep(600) && node.asleep() && gateway.asleep("plant-node-1"), "sleep");
+  gateway.publish(PUMP_TOPIC, "2");
+  check(node.readSubscription(50) == NULL, "nothing arrives while asleep");
+  uint32_t start = micros();
+  check(moistureM1.publish(1827), "QoS -1 publish while asleep");
+  check(node.wake(), "wake");
+  check(node.readSubscription(0) == &pump && strcmp((char *)pump.lastread, "2") == 0,
+        "held pump command delivered on wake");
+  uint32_t cycle = micros() - start;
+  check(node.asleep(), "back asleep after wake");
+  printf("wake, publish, collect, sleep: %u us on loopback\n", (unsigned)cycle);
+
+  // the gateway restarts and forgets the node
+  gateway.forget();
+  check(!node.wake(), "wake unanswered by a gateway that forgot us");
+  check(!node.asleep() && !node.connected(), "node knows it has no session");
+
+  // the sleepy node's recovery: register again, then sleep with the gateway
+  check(node.connect() == 0, "connect again");
+  check(humid.publish("40.4"), "publish by name in the new session");
+  check(gateway.registrations() == 2, "topic registered again in the new session");
+  got = waitForMessages(gateway, 7);
+  check(lastIs(got, "plant-node-1", HUMID_TOPIC, "40.4", 1), "gateway resolved the new id");
+  check(node.sleep(600), "sleep again");
+  gateway.publish(PUMP_TOPIC, "3");
+  check(node.wake() && node.readSubscription(0) == &pump &&
+        strcmp((char *)pump.lastread, "3") == 0, "subscription restored after registering again");
+
+  check(node.disconnect() && !gateway.connected("plant-node-1"), "disconnect");
+
+  if (failures)
+    return 1;
+  printf("mqtt-sn: QoS -1/0/1, REGISTER, sleep and wake, re-registration after a gateway restart\n");
+  return 0;
+}
@@ -0,0 +1,65 @@
+// An Adafruit_MQTT with no broker, for tests: keeps the last packet sent,
+// acknowledges QoS 1 publishes and hands the client whatever deliver()
+// queued, as if the broker had sent it.
+#pragma once
+
+#include "Adafruit_MQTT.h"
+
+#include <string>
+#include <vector>
+
+class RecordingMQTT : public Adafruit_MQTT {
+ public:
+  RecordingMQTT() : Adafruit_MQTT("host", 1883, "recorder", "user", "key") {}
+
+  std::vector<uint8_t> sent;
+  uint32_t packetsSent = 0;
+
+  bool connected() { return true; }
+
+  // A QoS 0 PUBLISH from the broker, read by the next readSubscription().
+  void deliver(const std::string &topic, const std::string &payload) {
+    uint32_t remaining = 2 + topic.size() + payload.size();
+    replies.push_back(MQTT_CTRL_PUBLISH << 4);
+    do {
+      uint8_t b = remaining % 128;
+      remaining /= 128;
+      replies.push_back(remaining ? b | 0x80 : b);
+    } while (remaining);
+    replies.push_back(topic.size() >> 8);
+    replies.push_back(topic.size() & 0xFF);
+    replies.insert(replies.end(), topic.begin(), topic.end());
+    replies.insert(replies.end(), payload.begin(), payload.end());
+  }
+
+ protected:
+  std::vector<uint8_t> replies;
+
+  bool connectServer() { return true; }
+  bool disconnectServer() { return true; }
+
+  bool sendPacket(uint8_t *buffer, uint16_t len) {
+    sent.assign(buffer, buffer + len);
+    packetsSent++;
+    if ((buffer[0] >> 4) == MQTT_CTRL_PUBLISH && (buffer[0] & 0x06)) {
+      // packet id follows the remaining length and the topic
+      uint16_t i = 1;
+      while (buffer[i] & 0x80)
+        i++;
+      i++;
+      i += 2 + (buffer[i] << 8 | buffer[i + 1]);
+      uint8_t puback[] = { MQTT_CTRL_PUBACK << 4, 2, buffer[i], buffer[i + 1] };
+      replies.insert(replies.end(), puback, puback + sizeof(puback));
+    }
+    return true;
+  }
+
+  uint16_t readPacket(uint8_t *buffer, uint16_t maxlen, int16_t timeout) {
+    uint16_t n = min(maxlen, replies.size());
+    memcpy(buffer, replies.data(), n);
+    replies.erase(replies.begin(), replies.begin() + n);
+    return n;
+  }
+
+  int bytesAvailable() { return replies.size(); }
+};
@@ -0,0 +1,16 @@
+// Runs a sketch on the host: setup() once, then loop() the given number
+// of times (default 1; the benchmarks do their work in setup()).
+
+#include "application.h"
+
+void setup();
+void loop();
+
+int main(int argc, char **argv) {
+  unsigned long loops = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+  setup();
+  while (loops--)
+    loop();
+  Serial.flush();
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Adafruit_SSD1306's drawing fast paths against the plain per-pixel ones.
+//
+// The same random drawing goes first to the driver as it is, then to
+// PixelDisplay, which sends every primitive through Adafruit_GFX's generic
+// code and so through drawPixel() one pixel at a time.  Every few
+// primitives each side calls display() and the emulated panel is
+// snapshotted; the two runs must leave identical panels at every
+// checkpoint.  Since display() only sends what was marked dirty, a fast
+// path that skips a dirty mark fails here as surely as one that draws the
+// wrong pixel.
+//
+//   ssd1306-equivalence <lines|text|fills> [primitives]
+
+// before the driver: Adafruit_GFX.h defines a swap() macro
+#include <vector>
+
+#include "Adafruit_SSD1306.h"
+#include "ssd1306-panel.h"
+
+class PixelDisplay : public Adafruit_SSD1306 {
+ public:
+  PixelDisplay() : Adafruit_SSD1306(-1) {}
+
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    Adafruit_GFX::drawLine(x0, y0, x1, y1, color);
+  }
+  // Not Adafruit_GFX's, which draws a line from y to y + h - 1 and so
+  // paints backwards for h <= 0; the driver draws nothing there.
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    for (int16_t i = 0; i < h; i++)
+      drawPixel(x, y + i, color);
+  }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    for (int16_t i = 0; i < w; i++)
+      drawPixel(x + i, y, color);
+  }
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                uint16_t bg, uint8_t size) {
+    Adafruit_GFX::drawChar(x, y, c, color, bg, size);
+  }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    Adafruit_GFX::fillRect(x, y, w, h, color);
+  }
+  void fillScreen(uint16_t color) {
+    Adafruit_GFX::fillScreen(color);
+  }
+};
+
+// Own generator, so both runs see the same sequence whatever else calls rand().
+static uint32_t seed;
+static uint32_t next(uint32_t n) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % n;
+}
+static int16_t between(int16_t lo, int16_t hi) {
+  return lo + next(hi - lo + 1);
+}
+
+// Four numbers drawn in order; as call arguments the order would be up to
+// the compiler.
+struct Quad {
+  int16_t a, b, c, d;
+  Quad(int16_t loA, int16_t hiA, int16_t loB, int16_t hiB,
+       int16_t loC, int16_t hiC, int16_t loD, int16_t hiD) {
+    a = between(loA, hiA);
+    b = between(loB, hiB);
+    c = between(loC, hiC);
+    d = between(loD, hiD);
+  }
+};
+
+static void drawLine(Adafruit_SSD1306 &d) {
+  // mostly on screen, some crossing the edges
+  Quad q = next(2) ? Quad(0, 127, 0, 63, 0, 127, 0, 63)
+                   : Quad(-20, 160, -20, 80, -20, 160, -20, 80);
+  d.drawLine(q.a, q.b, q.c, q.d, next(2));
+}
+
+static void drawText(Adafruit_SSD1306 &d) {
+  uint16_t fg = next(2);
+  // a third opaque, the rest transparent (bg == fg)
+  uint16_t bg = next(3) == 0 ? !fg : fg;
+  // every size the blitter takes and the first one it leaves to the
+  // per-pixel path
+  uint8_t size = between(1, SSD1306_BLIT_MAXSIZE + 1);
+  int16_t x = between(-10, 130);
+  int16_t y = between(-10, 70);
+  if (next(8)) {
+    d.drawChar(x, y, next(256), fg, bg, size);
+  } else {
+    d.setTextSize(size);
+    d.setTextColor(fg, bg);
+    d.setCursor(x, y);
+    d.print("Temp 72.5F");
+  }
+}
+
+static void drawFill(Adafruit_SSD1306 &d) {
+  uint8_t kind = next(50);
+  if (kind == 0) {
+    d.fillScreen(next(2));
+    return;
+  }
+  // anywhere, any size including empty ones, clipped at the edges; or
+  // small ones, for the top and bottom page masks
+  Quad q = kind < 25 ? Quad(-20, 140, -20, 80, -10, 140, -10, 80)
+                     : Quad(0, 127, 0, 63, 1, 8, 1, 12);
+  d.fillRect(q.a, q.b, q.c, q.d, next(2));
+}
+
+typedef void (*Primitive)(Adafruit_SSD1306 &d);
+
+struct Suite {
+  const char *name;
+  Primitive draw[2];
+};
+
+static const Suite suites[] = {
+  { "lines", { drawLine, drawLine } },
+  { "text",  { drawText, drawLine } },
+  { "fills", { drawFill, drawText } },
+};
+
+static const uint16_t CHECK_EVERY = 7;
+
+// Panel snapshots at every checkpoint.
+static std::vector<uint8_t> run(Adafruit_SSD1306 &d, const Suite &suite, uint32_t primitives) {
+  std::vector<uint8_t> panels;
+  d.begin(SSD1306_SWITCHCAPVCC, SSD1306_I2C_ADDRESS);
+  d.setTextWrap(false);
+  d.clearDisplay();
+  d.invalidate();
+  d.display();
+
+  seed = 12345;
+  for (uint32_t i = 0; i < primitives; i++) {
+    d.setRotation(next(4));
+    suite.draw[next(4) == 0](d);
+    if (i % CHECK_EVERY == CHECK_EVERY - 1) {
+      d.display();
+      panels.insert(panels.end(), &panel.gram[0][0], &panel.gram[0][0] + sizeof(panel.gram));
+    }
+  }
+  return panels;
+}
+
+int main(int argc, char **argv) {
+  const Suite *suite = NULL;
+  for (const Suite &s : suites)
+    if (argc > 1 && !strcmp(argv[1], s.name))
+      suite = &s;
+  if (!suite) {
+    fprintf(stderr, "usage: %s <lines|text|fills> [primitives]\n", argv[0]);
+    return 2;
+  }
+  uint32_t primitives = argc > 2 ? strtoul(argv[2], NULL, 0) : 20000;
+
+  Adafruit_SSD1306 fast(-1);
+  std::vector<uint8_t> expected, actual = run(fast, *suite, primitives);
+  PixelDisplay plain;
+  expected = run(plain, *suite, primitives);
+
+  size_t frame = sizeof(panel.gram), frames = expected.size() / frame;
+  for (size_t f = 0; f < frames; f++) {
+    if (memcmp(&expected[f * frame], &actual[f * frame], frame) == 0)
+      continue;
+    for (size_t i = 0; i < frame; i++) {
+      if (expected[f * frame + i] != actual[f * frame + i]) {
+        printf("%s: panel differs after primitive %zu, page %zu column %zu: %02x, expected %02x\n",
+               suite->name, (f + 1) * CHECK_EVERY, i / PANEL_COLUMNS, i % PANEL_COLUMNS,
+               actual[f * frame + i], expected[f * frame + i]);
+        return 1;
+      }
+    }
+  }
+  printf("%s: %u primitives, %zu panel checkpoints identical\n", suite->name,
+         (unsigned)primitives, frames);
+  return 0;
+}
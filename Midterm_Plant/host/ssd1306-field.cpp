@@ -0,0 +1,198 @@
+// Adafruit_SSD1306_Field against the drawing it replaced in the sketch: a
+// fillRect, setCursor and printf per dashboard line.  The panel has to end
+// up the same, and a reading that changes one character has to send only
+// that character's cell.
+//
+// The typed setters are checked against printf: set() returns the number
+// of cells it redrew, so setting printf's text right after setFixed() and
+// getting 0 back means both showed the same characters.
+
+#include "Adafruit_SSD1306_Field.h"
+#include "ssd1306-panel.h"
+
+static Adafruit_SSD1306 display(-1);
+
+// the sketch's dashboard
+static Adafruit_SSD1306_Field timeField(display, 0, 0, 21, "Time: ");
+static Adafruit_SSD1306_Field airField(display, 0, 10, 21, "Air Quality ");
+static Adafruit_SSD1306_Field tempField(display, 0, 20, 21, "Temp ");
+static Adafruit_SSD1306_Field humidField(display, 0, 30, 21, "Humid ");
+static Adafruit_SSD1306_Field moistField(display, 0, 40, 21, "Moisture ");
+static Adafruit_SSD1306_Field dustField(display, 0, 50, 21, "Dust ");
+static Adafruit_SSD1306_Field *const dashboard[] = {
+  &timeField, &airField, &tempField, &humidField, &moistField, &dustField
+};
+
+struct Reading {
+  const char *time;
+  int quality;
+  float tempF, humidRH;
+  int moisture;
+  float dust;
+};
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+// One screen the old way, top to bottom as the sketch drew it.
+static void drawOld(const Reading &r) {
+  display.fillRect(0, 0, 128, 10, BLACK);
+  display.setCursor(0, 0);
+  display.printf("Time: %s", r.time);
+  display.fillRect(0, 10, 128, 20, BLACK);
+  display.setCursor(0, 10);
+  display.printf("Air Quality %i", r.quality);
+  display.fillRect(0, 20, 128, 30, BLACK);
+  display.setCursor(0, 20);
+  display.printf("Temp %0.1f%cF", r.tempF, 248);
+  display.fillRect(0, 30, 128, 40, BLACK);
+  display.setCursor(0, 30);
+  display.printf("Humid %0.1f", r.humidRH);
+  display.fillRect(0, 40, 128, 50, BLACK);
+  display.setCursor(0, 40);
+  display.printf("Moisture %i", r.moisture);
+  display.fillRect(0, 50, 128, 60, BLACK);
+  display.setCursor(0, 50);
+  display.printf("Dust %.2f", r.dust);
+}
+
+static uint8_t drawFields(const Reading &r) {
+  return timeField.set(r.time) +
+         airField.printf("%i", r.quality) +
+         tempField.printf("%0.1f%cF", r.tempF, 248) +
+         humidField.printf("%0.1f", r.humidRH) +
+         moistField.printf("%i", r.moisture) +
+         dustField.printf("%.2f", r.dust);
+}
+
+// The sketch's typed calls for the same reading.
+static uint8_t drawTyped(const Reading &r) {
+  unsigned hour, minute, second;
+  sscanf(r.time, "%u:%u:%u", &hour, &minute, &second);
+  return timeField.setTime(hour, minute, second) +
+         airField.setInt(r.quality) +
+         tempField.setFixed(r.tempF, 1, "\xF8" "F") +
+         humidField.setFixed(r.humidRH, 1) +
+         moistField.setInt(r.moisture) +
+         dustField.setFixed(r.dust, 2);
+}
+
+// setFixed(value, decimals) must show what "%.*f" does, except that a
+// value rounding to zero has no minus sign.
+static bool sameAsPrintf(Adafruit_SSD1306_Field &field, float value, uint8_t decimals) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  const char *shown = text;
+  if (text[0] == '-' && strspn(text + 1, "0.") == strlen(text + 1))
+    shown++;
+  field.setFixed(value, decimals);
+  if (field.set(shown) == 0)
+    return true;
+  printf("setFixed(%.9g, %u) differs from \"%s\"\n", value, decimals, shown);
+  return false;
+}
+
+static void checkTyped(const Reading *readings, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    drawFields(readings[i]);
+    check(drawTyped(readings[i]) == 0, "typed setters draw what printf did");
+  }
+
+  Adafruit_SSD1306_Field field(display, 0, 0, 21);
+  uint32_t mismatches = 0;
+  srand(1);
+  for (uint32_t i = 0; i < 100000; i++) {
+    float value = (rand() % 20000) / 100.0f;
+    if (i & 1)
+      value = -value;
+    mismatches += !sameAsPrintf(field, value, i % (SSD1306_FIELD_MAXDECIMALS + 1));
+  }
+  // exact ties go to even, the way printf rounds
+  static const float ties[] = { 71.25f, 71.75f, 0.125f, 2.5f, 3.5f, -0.5f, 429496.7f };
+  for (float value : ties)
+    for (uint8_t decimals = 0; decimals <= SSD1306_FIELD_MAXDECIMALS; decimals++)
+      mismatches += !sameAsPrintf(field, value, decimals);
+  check(mismatches == 0, "setFixed rounds like printf");
+
+  // nothing it can't show gets converted
+  static const float unshowable[] = { NAN, INFINITY, -INFINITY, 1e12f, -5e9f };
+  for (float value : unshowable) {
+    field.setFixed(value, 2, "F");
+    check(field.set("--F") == 0, "setFixed shows -- for NaN, infinity and overflow");
+  }
+}
+
+int main() {
+  display.begin(SSD1306_SWITCHCAPVCC, SSD1306_I2C_ADDRESS);
+  display.setTextColor(WHITE);
+  display.setTextWrap(false);
+
+  static const Reading readings[] = {
+    { "08:59:45", 12, 71.3, 40.2, 1830, 0.52 },
+    { "09:00:00", 12, 71.4, 40.2, 1830, 0.52 },   // one digit of the temperature
+    { "09:00:15", 9, 69.9, 41.0, 2104, 12.25 },
+    { "09:00:30", 131, 100.2, 39.9, 987, 0.0 },
+    { "09:00:45", 7, -3.5, 100.0, 12, 4.5 },
+  };
+
+  uint8_t expected[PANEL_PAGES][PANEL_COLUMNS];
+  const Reading *previous = NULL;
+  for (const Reading &r : readings) {
+    // the old way, from a blank panel: it sends every line it cleared,
+    // whatever changed
+    display.clearDisplay();
+    display.invalidate();
+    display.display();
+    drawOld(r);
+    display.display();
+    uint16_t oldBytes = display.lastFlushBytes();
+    memcpy(expected, panel.gram, sizeof(expected));
+
+    // the fields, from the previous reading as they last drew it
+    display.clearDisplay();
+    for (Adafruit_SSD1306_Field *field : dashboard)
+      field->redraw();
+    if (previous)
+      drawFields(*previous);
+    display.invalidate();
+    display.display();
+    uint8_t cells = drawFields(r);
+    display.display();
+    uint16_t fieldBytes = display.lastFlushBytes();
+    previous = &r;
+
+    printf("%s temp %5.1f: %2u cells changed, %4u bytes sent (fillRect and printf: %u)\n",
+           r.time, r.tempF, cells, fieldBytes, oldBytes);
+    check(memcmp(panel.gram, expected, sizeof(expected)) == 0, "panel matches the old drawing");
+    check(fieldBytes < oldBytes, "fields send less than the old drawing");
+  }
+
+  // 71.3 -> 71.4 changes only the temperature's tenths: one cell, 6
+  // columns on the two pages that rows 20-27 cross.
+  display.clearDisplay();
+  for (Adafruit_SSD1306_Field *field : dashboard)
+    field->redraw();
+  drawFields(readings[0]);
+  display.display();
+  Reading r = readings[0];
+  r.tempF = 71.4;
+  check(drawFields(r) == 1, "one cell drawn for 71.3 -> 71.4");
+  display.display();
+  check(display.lastFlushBytes() == 12, "12 bytes sent for 71.3 -> 71.4");
+
+  uint16_t singleDigit = display.lastFlushBytes();
+
+  checkTyped(readings, sizeof(readings) / sizeof(readings[0]));
+
+  if (failures)
+    return 1;
+  printf("fields: panels identical, single digit change sends %u bytes, "
+         "typed setters match printf\n", (unsigned)singleDigit);
+  return 0;
+}
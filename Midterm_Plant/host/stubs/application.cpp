@@ -0,0 +1,178 @@
+#include "application.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+USBSerial Serial;
+SPIClass SPI;
+
+static std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void advanceClock(uint32_t ms) {
+  bootTime -= std::chrono::milliseconds(ms);
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+int32_t random(int32_t max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+int32_t random(int32_t min, int32_t max) {
+  return max > min ? min + rand() % (max - min) : min;
+}
+
+void pinMode(uint16_t pin, int mode) {}
+void digitalWrite(uint16_t pin, uint8_t value) {}
+int32_t digitalRead(uint16_t pin) { return HIGH; }
+int32_t analogRead(uint16_t pin) { return 0; }
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t order, uint8_t value) {}
+
+char *itoa(int value, char *buf, int base) { return ltoa(value, buf, base); }
+
+char *ltoa(long value, char *buf, int base) {
+  if (value < 0 && base == 10) {
+    buf[0] = '-';
+    ultoa(-(unsigned long)value, buf + 1, base);
+  } else {
+    ultoa(value, buf, base);
+  }
+  return buf;
+}
+
+char *ultoa(unsigned long value, char *buf, int base) {
+  char digits[sizeof(value) * 8];
+  uint8_t n = 0;
+  do {
+    digits[n++] = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+    value /= base;
+  } while (value);
+  for (uint8_t i = 0; i < n; i++)
+    buf[i] = digits[n - 1 - i];
+  buf[n] = 0;
+  return buf;
+}
+
+// Print ////////////////////////////////////////////////////////////////////
+
+size_t Print::write(const uint8_t *buf, size_t len) {
+  size_t n = 0;
+  while (len--)
+    n += write(*buf++);
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  char buf[sizeof(n) * 8 + 2];
+  return write(ltoa(n, buf, base));
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buf[sizeof(n) * 8 + 1];
+  return write(ultoa(n, buf, base));
+}
+
+size_t Print::print(double n, int digits) {
+  return printf("%.*f", digits, n);
+}
+
+size_t Print::vprintf(const char *format, va_list args) {
+  char buf[256];
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  if (n < 0)
+    return 0;
+  return write((const uint8_t *)buf, min(n, (int)sizeof(buf) - 1));
+}
+
+size_t Print::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+size_t Print::printlnf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintf(format, args);
+  va_end(args);
+  return n + println();
+}
+
+// Concurrency //////////////////////////////////////////////////////////////
+
+int os_mutex_create(os_mutex_t *mutex) {
+  *mutex = new std::mutex;
+  return 0;
+}
+
+int os_mutex_lock(os_mutex_t mutex) {
+  static_cast<std::mutex *>(mutex)->lock();
+  return 0;
+}
+
+int os_mutex_unlock(os_mutex_t mutex) {
+  static_cast<std::mutex *>(mutex)->unlock();
+  return 0;
+}
+
+struct HostSemaphore {
+  std::mutex lock;
+  std::condition_variable changed;
+  unsigned count, max;
+};
+
+int os_semaphore_create(os_semaphore_t *semaphore, unsigned max, unsigned initial) {
+  HostSemaphore *s = new HostSemaphore;
+  s->count = initial;
+  s->max = max;
+  *semaphore = s;
+  return 0;
+}
+
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeout, bool reserved) {
+  HostSemaphore *s = static_cast<HostSemaphore *>(semaphore);
+  std::unique_lock<std::mutex> guard(s->lock);
+  auto ready = [s] { return s->count > 0; };
+  if (timeout == CONCURRENT_WAIT_FOREVER)
+    s->changed.wait(guard, ready);
+  else if (!s->changed.wait_for(guard, std::chrono::milliseconds(timeout), ready))
+    return 1;
+  s->count--;
+  return 0;
+}
+
+int os_semaphore_give(os_semaphore_t semaphore, bool reserved) {
+  HostSemaphore *s = static_cast<HostSemaphore *>(semaphore);
+  {
+    std::lock_guard<std::mutex> guard(s->lock);
+    if (s->count < s->max)
+      s->count++;
+  }
+  s->changed.notify_one();
+  return 0;
+}
+
+Thread::Thread(const char *name, wiring_thread_fn_t function, void *arg,
+               uint8_t priority, size_t stack) {
+  std::thread(function, arg).detach();
+}
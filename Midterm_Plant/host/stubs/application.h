@@ -0,0 +1,229 @@
+// Just enough of Device OS to build the libraries and benchmark examples on
+// a Linux PC.  Timing is real (steady clock), pins are no-ops, Serial is
+// stdout and Wire is the SSD1306 emulator in ssd1306-panel.cpp.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <time.h>
+#include <new>
+#include <type_traits>
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint32_t system_tick_t;
+
+template <class A, class B>
+auto min(A a, B b) -> typename std::common_type<A, B>::type { return a < b ? a : b; }
+template <class A, class B>
+auto max(A a, B b) -> typename std::common_type<A, B>::type { return a > b ? a : b; }
+
+#define F(x) (x)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+
+#define DEC 10
+#define HEX 16
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+#define OUTPUT_OPEN_DRAIN 4
+#define MSBFIRST 1
+#define SPI_MODE0 0
+#define SPI_CLOCK_DIV8 8
+#define CLOCK_SPEED_100KHZ 100000
+#define CLOCK_SPEED_400KHZ 400000
+
+enum { D0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14, D15, D16,
+       A0 = 100, A1, A2, A3, A4, A5 };
+enum { SDA = D0, SCL = D1 };
+
+// 32 bit counters that wrap like the device's
+unsigned long millis();
+unsigned long micros();
+// Host only: moves the clock forward, for long uptimes in tests.
+void advanceClock(uint32_t ms);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+int32_t random(int32_t max);
+int32_t random(int32_t min, int32_t max);
+
+void pinMode(uint16_t pin, int mode);
+void digitalWrite(uint16_t pin, uint8_t value);
+int32_t digitalRead(uint16_t pin);
+int32_t analogRead(uint16_t pin);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t order, uint8_t value);
+
+char *itoa(int value, char *buf, int base);
+char *ltoa(long value, char *buf, int base);
+char *ultoa(unsigned long value, char *buf, int base);
+
+// waitFor(Serial.isConnected, ms) and friends: the host is always ready.
+// A call rather than a constant, so a waitFor() on its own line doesn't
+// warn about a statement with no effect.
+inline bool hostReady() { return true; }
+#define waitFor(condition, timeout) hostReady()
+#define SYSTEM_MODE(mode)
+#define SYSTEM_THREAD(mode)
+#define ATOMIC_BLOCK() for (int _once = 1; _once; _once = 0)
+#define SINGLE_THREADED_BLOCK() for (int _once = 1; _once; _once = 0)
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len);
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(T value) { return print(value) + println(); }
+  template <class T> size_t println(T value, int format) { return print(value, format) + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  size_t printlnf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+ private:
+  size_t vprintf(const char *format, va_list args);
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+};
+
+class USBSerial : public Stream {
+ public:
+  void begin(long baud) {}
+  bool isConnected() { return true; }
+  operator bool() { return true; }
+  size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t write(const uint8_t *buf, size_t len) { return fwrite(buf, 1, len, stdout); }
+  using Print::write;
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  void flush() { fflush(stdout); }
+};
+extern USBSerial Serial;
+
+class TwoWire : public Stream {
+ public:
+  void begin() {}
+  void end() {}
+  void reset() {}
+  bool isEnabled() { return true; }
+  void setSpeed(uint32_t hz);
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(uint8_t stop = true);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buf, size_t len);
+  using Print::write;
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available();
+  int read();
+  int peek() { return -1; }
+  void flush() {}
+  void lock();
+  void unlock();
+};
+extern TwoWire Wire;
+
+class SPISettings {
+ public:
+  SPISettings(uint32_t clock, uint8_t order, uint8_t mode) {}
+};
+
+class SPIClass {
+ public:
+  void begin() {}
+  void beginTransaction(SPISettings settings) {}
+  void endTransaction() {}
+  void setBitOrder(uint8_t order) {}
+  void setClockDivider(uint8_t divider) {}
+  void setDataMode(uint8_t mode) {}
+  uint8_t transfer(uint8_t c) { return 0; }
+};
+extern SPIClass SPI;
+
+class IPAddress {
+ public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{ a, b, c, d } {}
+  uint8_t operator[](int i) const { return octets[i]; }
+  uint8_t &operator[](int i) { return octets[i]; }
+
+ private:
+  uint8_t octets[4];
+};
+
+// A real UDP socket, see udp.cpp.
+class UDP {
+ public:
+  UDP() : fd(-1) {}
+  ~UDP() { stop(); }
+  uint8_t begin(uint16_t port);
+  void stop();
+  int sendPacket(const uint8_t *buffer, size_t size, IPAddress ip, uint16_t port);
+  // Doesn't wait: the next datagram's length, or 0 with nothing waiting.
+  int receivePacket(uint8_t *buffer, size_t size);
+
+ private:
+  int fd;
+};
+
+template <class T>
+struct HostLockGuard {
+  T &lockable;
+  bool once;
+  HostLockGuard(T &t) : lockable(t), once(true) { lockable.lock(); }
+  ~HostLockGuard() { lockable.unlock(); }
+};
+#define WITH_LOCK(obj) for (HostLockGuard<decltype(obj)> _guard(obj); _guard.once; _guard.once = false)
+
+// Device OS concurrency HAL, on top of std::thread.
+typedef void *os_mutex_t;
+typedef void *os_semaphore_t;
+typedef void os_thread_return_t;
+#define CONCURRENT_WAIT_FOREVER ((system_tick_t)-1)
+int os_mutex_create(os_mutex_t *mutex);
+int os_mutex_lock(os_mutex_t mutex);
+int os_mutex_unlock(os_mutex_t mutex);
+int os_semaphore_create(os_semaphore_t *semaphore, unsigned max, unsigned initial);
+int os_semaphore_take(os_semaphore_t semaphore, system_tick_t timeout, bool reserved);
+int os_semaphore_give(os_semaphore_t semaphore, bool reserved);
+
+typedef os_thread_return_t (*wiring_thread_fn_t)(void *arg);
+class Thread {
+ public:
+  Thread(const char *name, wiring_thread_fn_t function, void *arg = NULL,
+         uint8_t priority = 2, size_t stack = 3072);
+};
+
+typedef struct {
+  uint16_t size;
+  uint16_t version;
+  uint8_t *rx_buffer;
+  uint32_t rx_buffer_size;
+  uint8_t *tx_buffer;
+  uint32_t tx_buffer_size;
+} hal_i2c_config_t;
+#define HAL_I2C_CONFIG_VERSION_1 1
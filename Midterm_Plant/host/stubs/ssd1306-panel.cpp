@@ -0,0 +1,143 @@
+#include "ssd1306-panel.h"
+
+#include <mutex>
+
+SSD1306Panel panel;
+TwoWire Wire;
+
+// the driver's flush thread and the sketch share the bus, as on the device
+static std::recursive_mutex busLock;
+
+// bytes of the transaction being built, control byte first
+static uint8_t frame[2048];
+static size_t frameLen;
+static int readByte = -1;
+
+// addressing window and the next GDDRAM write position
+static uint8_t colStart = 0, colEnd = PANEL_COLUMNS - 1, col = 0;
+static uint8_t pageStart = 0, pageEnd = PANEL_PAGES - 1, page = 0;
+
+// command waiting for its arguments
+static uint8_t command, args[6], argCount, argsWanted;
+
+static uint8_t argumentsOf(uint8_t c) {
+  switch (c) {
+    case 0x21: case 0x22: case 0xA3:
+      return 2;
+    case 0x26: case 0x27:
+      return 6;
+    case 0x29: case 0x2A:
+      return 5;
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+      return 1;
+  }
+  return 0;
+}
+
+static void commandByte(uint8_t b) {
+  if (argsWanted) {
+    args[argCount++] = b;
+    if (argCount < argsWanted)
+      return;
+    argsWanted = 0;
+    if (command == 0x21) {
+      colStart = col = args[0] & 0x7F;
+      colEnd = args[1] & 0x7F;
+    } else if (command == 0x22) {
+      pageStart = page = args[0] & 7;
+      pageEnd = args[1] & 7;
+    }
+    return;
+  }
+  if (b == 0xAE)
+    panel.on = false;
+  else if (b == 0xAF)
+    panel.on = true;
+  argsWanted = argumentsOf(b);
+  if (argsWanted) {
+    command = b;
+    argCount = 0;
+  }
+}
+
+static void dataByte(uint8_t b) {
+  panel.gram[page][col] = b;
+  if (col != colEnd) {
+    col++;
+    return;
+  }
+  col = colStart;
+  page = page == pageEnd ? pageStart : page + 1;
+}
+
+void SSD1306Panel::reset() {
+  memset(gram, 0, sizeof(gram));
+  transactions = bytes = 0;
+}
+
+void TwoWire::setSpeed(uint32_t hz) {
+  panel.busSpeed = hz;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  frameLen = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+  if (frameLen >= sizeof(frame))
+    return 0;
+  frame[frameLen++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *buf, size_t len) {
+  size_t n = 0;
+  while (n < len && write(buf[n]))
+    n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(uint8_t stop) {
+  panel.transactions++;
+  panel.bytes += frameLen;
+  if (!frameLen)
+    return 0;
+  // control byte: 0x40 data stream, 0x00 command stream, 0x80 one command
+  // per control byte
+  if (frame[0] == 0x40) {
+    for (size_t i = 1; i < frameLen; i++)
+      dataByte(frame[i]);
+  } else if (frame[0] == 0x00) {
+    for (size_t i = 1; i < frameLen; i++)
+      commandByte(frame[i]);
+  } else if (frame[0] == 0x80) {
+    for (size_t i = 1; i < frameLen; i += 2)
+      commandByte(frame[i]);
+  }
+  return 0;
+}
+
+// status register: bit 6 set while the display is off
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  readByte = panel.on ? 0x00 : 0x40;
+  return 1;
+}
+
+int TwoWire::available() {
+  return readByte >= 0;
+}
+
+int TwoWire::read() {
+  int b = readByte;
+  readByte = -1;
+  return b;
+}
+
+void TwoWire::lock() {
+  busLock.lock();
+}
+
+void TwoWire::unlock() {
+  busLock.unlock();
+}
@@ -0,0 +1,26 @@
+// Emulated SSD1306 on the host's Wire bus.  It decodes the command stream
+// the driver sends (addressing window, display on/off) and writes data
+// bytes into its own GDDRAM in horizontal addressing mode, so a test can
+// check what actually reached the panel rather than the driver's buffer.
+#pragma once
+
+#include "application.h"
+
+#define PANEL_PAGES 8
+#define PANEL_COLUMNS 128
+
+struct SSD1306Panel {
+  uint8_t gram[PANEL_PAGES][PANEL_COLUMNS];
+  bool on;
+  // I2C transactions and bytes (control bytes included) since reset()
+  uint32_t transactions;
+  uint32_t bytes;
+  uint32_t busSpeed;
+
+  // Blank GDDRAM, zero the counters.
+  void reset();
+  // Pixel (x, y) in panel coordinates.
+  bool pixel(int x, int y) const { return gram[y / 8][x] >> (y & 7) & 1; }
+};
+
+extern SSD1306Panel panel;
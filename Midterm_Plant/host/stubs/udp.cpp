@@ -0,0 +1,45 @@
+#include "application.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+uint8_t UDP::begin(uint16_t port) {
+  stop();
+  fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (fd < 0)
+    return 0;
+  sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  local.sin_port = htons(port);
+  if (bind(fd, (sockaddr *)&local, sizeof(local)) < 0) {
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+void UDP::stop() {
+  if (fd >= 0)
+    close(fd);
+  fd = -1;
+}
+
+int UDP::sendPacket(const uint8_t *buffer, size_t size, IPAddress ip, uint16_t port) {
+  if (fd < 0)
+    return -1;
+  sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_addr.s_addr = htonl((uint32_t)ip[0] << 24 | ip[1] << 16 | ip[2] << 8 | ip[3]);
+  to.sin_port = htons(port);
+  return sendto(fd, buffer, size, 0, (sockaddr *)&to, sizeof(to));
+}
+
+int UDP::receivePacket(uint8_t *buffer, size_t size) {
+  if (fd < 0)
+    return -1;
+  ssize_t n = recv(fd, buffer, size, 0);
+  return n < 0 ? 0 : n;
+}
@@ -39,7 +39,7 @@
 */
 /**************************************************************************/
 Adafruit_BME280::Adafruit_BME280()
-    : _cs(-1), _mosi(-1), _miso(-1), _sck(-1)
+    : _i2cErrors(0), _cs(-1), _mosi(-1), _miso(-1), _sck(-1)
 { }
 
 /**************************************************************************/
@@ -49,7 +49,7 @@ Adafruit_BME280::Adafruit_BME280()
 */
 /**************************************************************************/
 Adafruit_BME280::Adafruit_BME280(int8_t cspin)
-    : _cs(cspin), _mosi(-1), _miso(-1), _sck(-1)
+    : _i2cErrors(0), _cs(cspin), _mosi(-1), _miso(-1), _sck(-1)
 { }
 
 /**************************************************************************/
@@ -62,7 +62,7 @@ Adafruit_BME280::Adafruit_BME280(int8_t cspin)
 */
 /**************************************************************************/
 Adafruit_BME280::Adafruit_BME280(int8_t cspin, int8_t mosipin, int8_t misopin, int8_t sckpin)
-    : _cs(cspin), _mosi(mosipin), _miso(misopin), _sck(sckpin)
+    : _i2cErrors(0), _cs(cspin), _mosi(mosipin), _miso(misopin), _sck(sckpin)
 { }
 
 
@@ -255,7 +255,8 @@ void Adafruit_BME280::write8(byte reg, byte value) {
         _wire -> beginTransmission((uint8_t)_i2caddr);
         _wire -> write((uint8_t)reg);
         _wire -> write((uint8_t)value);
-        _wire -> endTransmission();
+        if (_wire -> endTransmission())
+            _i2cErrors++;
     } else {
         if (_sck == -1)
             SPI.beginTransaction(SPISettings(500000, MSBFIRST, SPI_MODE0));
@@ -282,8 +283,10 @@ uint8_t Adafruit_BME280::read8(byte reg) {
     if (_cs == -1) {
         _wire -> beginTransmission((uint8_t)_i2caddr);
         _wire -> write((uint8_t)reg);
-        _wire -> endTransmission();
-        _wire -> requestFrom((uint8_t)_i2caddr, (byte)1);
+        if (_wire -> endTransmission())
+            _i2cErrors++;
+        if (_wire -> requestFrom((uint8_t)_i2caddr, (byte)1) != 1)
+            _i2cErrors++;
         value = _wire -> read();
     } else {
         if (_sck == -1)
@@ -313,8 +316,10 @@ uint16_t Adafruit_BME280::read16(byte reg)
     if (_cs == -1) {
         _wire -> beginTransmission((uint8_t)_i2caddr);
         _wire -> write((uint8_t)reg);
-        _wire -> endTransmission();
-        _wire -> requestFrom((uint8_t)_i2caddr, (byte)2);
+        if (_wire -> endTransmission())
+            _i2cErrors++;
+        if (_wire -> requestFrom((uint8_t)_i2caddr, (byte)2) != 2)
+            _i2cErrors++;
         value = (_wire -> read() << 8) | _wire -> read();
     } else {
         if (_sck == -1)
@@ -384,8 +389,10 @@ uint32_t Adafruit_BME280::read24(byte reg)
     if (_cs == -1) {
         _wire -> beginTransmission((uint8_t)_i2caddr);
         _wire -> write((uint8_t)reg);
-        _wire -> endTransmission();
-        _wire -> requestFrom((uint8_t)_i2caddr, (byte)3);
+        if (_wire -> endTransmission())
+            _i2cErrors++;
+        if (_wire -> requestFrom((uint8_t)_i2caddr, (byte)3) != 3)
+            _i2cErrors++;
 
         value = _wire -> read();
         value <<= 8;
@@ -630,4 +637,51 @@ float Adafruit_BME280::seaLevelForAltitude(float altitude, float atmospheric)
 uint32_t Adafruit_BME280::sensorID(void)
 {
 	return _sensorID;
-}
\ No newline at end of file
+}
+
+/**************************************************************************/
+/*!
+    @brief  Number of I2C transfers that failed (NACK, bus error, short
+            read) since power up
+    @returns the error count
+*/
+/**************************************************************************/
+uint32_t Adafruit_BME280::i2cErrors(void)
+{
+    return _i2cErrors;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Check the sensor still answers and still has the settings
+            from setSampling(). A brown-out puts it back to sleep with
+            everything cleared.
+    @returns true if the sensor is there and configured
+*/
+/**************************************************************************/
+bool Adafruit_BME280::probe(void)
+{
+    if (read8(BME280_REGISTER_CHIPID) != 0x60)
+        return false;
+    // in forced mode the chip drops back to sleep by itself
+    uint8_t mask = (_measReg.mode == MODE_NORMAL) ? 0xFF : 0xFC;
+    return (read8(BME280_REGISTER_CONTROL) & mask) == (_measReg.get() & mask);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Restore the sensor after a bus fault or brown-out without the
+            soft reset and delays of begin(). The calibration data read
+            by begin() stays valid, only the settings are written again.
+    @returns true if the sensor answers and took the settings
+*/
+/**************************************************************************/
+bool Adafruit_BME280::recover(void)
+{
+    if (read8(BME280_REGISTER_CHIPID) != 0x60)
+        return false;
+    write8(BME280_REGISTER_CONTROLHUMID, _humReg.get());
+    write8(BME280_REGISTER_CONFIG, _configReg.get());
+    write8(BME280_REGISTER_CONTROL, _measReg.get());
+    return probe();
+}
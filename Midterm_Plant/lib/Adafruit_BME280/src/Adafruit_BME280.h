@@ -226,6 +226,10 @@ class Adafruit_BME280 {
         float readAltitude(float seaLevel);
         float seaLevelForAltitude(float altitude, float pressure);
 		uint32_t sensorID(void);
+
+        uint32_t i2cErrors(void);
+        bool probe(void);
+        bool recover(void);
         
     protected:
 		TwoWire *_wire; //!< pointer to a TwoWire object
@@ -243,6 +247,7 @@ class Adafruit_BME280 {
 
         uint8_t   _i2caddr; //!< I2C addr for the TwoWire interface
         int32_t   _sensorID; //!< ID of the BME Sensor
+        uint32_t  _i2cErrors; //!< failed I2C transfers
         int32_t   t_fine; //!< temperature with high resolution, stored as an attribute as this is used for temperature compensation reading humidity and pressure
 
         int8_t _cs;   //!< for the SPI interface
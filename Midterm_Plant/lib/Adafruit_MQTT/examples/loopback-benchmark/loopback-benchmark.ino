@@ -0,0 +1,138 @@
+#include "Adafruit_MQTT.h"
+#include "Adafruit_MQTT_Loopback.h"
+#include <inttypes.h>
+
+// Throughput benchmark for the Adafruit_MQTT protocol code.  Uses the
+// in-memory loopback broker so the numbers measure the client itself, not
+// the Wi-Fi.  Results go to the serial monitor.
+
+/************ Global State ******************/
+Adafruit_MQTT_Loopback mqtt("bench", "user", "key");
+
+Adafruit_MQTT_Publish pub0 = Adafruit_MQTT_Publish(&mqtt, "user/feeds/bench0");
+Adafruit_MQTT_Publish pub1 = Adafruit_MQTT_Publish(&mqtt, "user/feeds/bench1", MQTT_QOS_1);
+Adafruit_MQTT_Publish echo = Adafruit_MQTT_Publish(&mqtt, "user/feeds/echo");
+Adafruit_MQTT_Subscribe echoSub = Adafruit_MQTT_Subscribe(&mqtt, "user/feeds/echo");
+
+// a realistically long Adafruit IO topic, where the per-publish header work shows
+#define LONG_TOPIC "someusername/feeds/greenhouse-bench-soil-moisture"
+Adafruit_MQTT_Publish pubLong = Adafruit_MQTT_Publish(&mqtt, LONG_TOPIC);
+
+const uint16_t MESSAGES = 1000;
+// the header work is tens of nanoseconds on a PC, time enough of it to see
+const uint32_t HEADER_MESSAGES = 200000;
+const uint16_t RECONNECTS = 50;
+
+/*************************** Sketch Code ************************************/
+void publishRate(Adafruit_MQTT_Publish &feed, const char *label)
+{
+    mqtt.resetCounters();
+    uint16_t ok = 0;
+    uint32_t start = micros();
+    for (uint16_t i=0; i<MESSAGES; i++) {
+        if (!mqtt.connected()) mqtt.connect();
+        if (feed.publish((int)i)) ok++;
+    }
+    uint32_t us = micros() - start;
+
+    Serial.printf("%s: %u/%u ok, %.0f msg/s, %.1f bytes/msg out, %.1f bytes/msg in\n",
+                  label, ok, MESSAGES, MESSAGES * 1e6 / us,
+                  (double)mqtt.bytesSent / MESSAGES,
+                  (double)mqtt.bytesReceived / MESSAGES);
+}
+
+// Same packets two ways: by topic string, which works out the header on
+// every call, and through a publisher, which cached it when it was built.
+void headerCost()
+{
+    const char *payload = "1234";
+    uint32_t start = micros();
+    for (uint32_t i=0; i<HEADER_MESSAGES; i++) {
+        mqtt.publish(LONG_TOPIC, payload);
+    }
+    uint32_t byTopic = micros() - start;
+
+    start = micros();
+    for (uint32_t i=0; i<HEADER_MESSAGES; i++) {
+        pubLong.publish(payload);
+    }
+    uint32_t cached = micros() - start;
+
+    Serial.printf("publish header, %" PRIu32 " messages: by topic %" PRIu32 " us (%.3f us/msg), cached %" PRIu32 " us (%.3f us/msg)\n",
+                  HEADER_MESSAGES, byTopic, (double)byTopic / HEADER_MESSAGES,
+                  cached, (double)cached / HEADER_MESSAGES);
+}
+
+void dispatchLatency()
+{
+    uint32_t total = 0, worst = 0;
+    uint16_t got = 0;
+    for (uint16_t i=0; i<MESSAGES; i++) {
+        if (!mqtt.connected()) mqtt.connect();
+        uint32_t start = micros();
+        echo.publish((int)i);
+        if (mqtt.readSubscription(100) == &echoSub) {
+            uint32_t us = micros() - start;
+            total += us;
+            if (us > worst) worst = us;
+            got++;
+        }
+    }
+    Serial.printf("dispatch: %u/%u delivered, avg %" PRIu32 " us, worst %" PRIu32 " us\n",
+                  got, MESSAGES, got ? total / got : 0, worst);
+}
+
+void reconnectTime()
+{
+    uint32_t total = 0;
+    uint16_t ok = 0;
+    for (uint16_t i=0; i<RECONNECTS; i++) {
+        mqtt.disconnect();
+        uint32_t start = micros();
+        if (mqtt.connect() == 0) {
+            total += micros() - start;
+            ok++;
+        }
+    }
+    Serial.printf("reconnect+resubscribe: %u/%u ok, avg %" PRIu32 " us\n",
+                  ok, RECONNECTS, ok ? total / ok : 0);
+}
+
+void runAll(const char *title)
+{
+    Serial.printf("\n--- %s ---\n", title);
+    mqtt.disconnect();
+    mqtt.connect();
+    publishRate(pub0, "QoS 0");
+    publishRate(pub1, "QoS 1");
+    dispatchLatency();
+    reconnectTime();
+    Serial.printf("link drops: %" PRIu32 ", packets lost: %" PRIu32 "\n", mqtt.disconnects, mqtt.packetsDropped);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    waitFor(Serial.isConnected, 10000);
+
+    mqtt.subscribe(&echoSub);
+
+    runAll("clean link");
+    headerCost();
+
+    mqtt.setLatency(5);
+    runAll("5 ms reply latency");
+    mqtt.setLatency(0);
+
+    mqtt.setLoss(2);
+    runAll("2% packet loss");
+    mqtt.setLoss(0);
+
+    mqtt.setDisconnectEvery(200);
+    runAll("link drop every 200 packets");
+    mqtt.setDisconnectEvery(0);
+}
+
+void loop()
+{
+}
@@ -0,0 +1,83 @@
+#include "Adafruit_MQTTSN.h"
+
+// Battery node talking MQTT-SN to a gateway on the local network.  Each
+// wake-up publishes the soil moisture with QoS -1 (no CONNECT, one
+// datagram), picks up any pump command the gateway buffered while we were
+// asleep, and goes back to sleep.
+//
+// The topic ids below have to match the gateway's predefined topic file,
+// e.g. for the Paho gateway:
+//   1  <user>/feeds/soilmoisture
+//   2  <user>/feeds/turnonpump
+
+SYSTEM_THREAD(ENABLED);
+
+/************ Global State ******************/
+const IPAddress GATEWAY(192, 168, 1, 10);
+const uint16_t GATEWAY_PORT = 10000;
+
+const uint16_t TOPIC_MOISTURE = 1;
+const uint16_t TOPIC_PUMP = 2;
+
+const int PINMOIST = A1;
+const int PINPUMP = D16;
+const uint16_t SLEEP_S = 300;
+
+UDP udp;
+Adafruit_MQTTSN mqttsn(&udp, GATEWAY, GATEWAY_PORT, "plant-node-1");
+
+Adafruit_MQTTSN_Publish moisture = Adafruit_MQTTSN_Publish(&mqttsn, TOPIC_MOISTURE, MQTTSN_QOS_M1);
+Adafruit_MQTTSN_Subscribe pump = Adafruit_MQTTSN_Subscribe(&mqttsn, TOPIC_PUMP, 1);
+
+/*************************** Sketch Code ************************************/
+// Register with the gateway so it holds pump commands for us, then tell it
+// we're asleep.  Returns false if the gateway didn't answer.
+bool registerNode()
+{
+    if (mqttsn.connect() != 0) {
+        Serial.printf("gateway didn't answer\n");
+        return false;
+    }
+    return mqttsn.sleep(SLEEP_S * 2);
+}
+
+void setup()
+{
+    Serial.begin(9600);
+    pinMode(PINPUMP, OUTPUT);
+    WiFi.on();
+    WiFi.connect();
+    waitFor(WiFi.ready, 15000);
+
+    mqttsn.subscribe(&pump);
+    registerNode();
+}
+
+void loop()
+{
+    // the radio reconnects by itself after STOP sleep, but a datagram sent
+    // before it's up is just dropped
+    if (waitFor(WiFi.ready, 15000)) {
+        moisture.publish(analogRead(PINMOIST));
+
+        // wake() only works once the gateway knows we're asleep.  If that
+        // never happened, or the gateway forgot us and wake() got no
+        // answer, register again; nothing was held for us either way.
+        if (mqttsn.asleep() && mqttsn.wake()) {
+            Adafruit_MQTTSN_Subscribe *sub;
+            while ((sub = mqttsn.readSubscription(0))) {
+                if (sub == &pump && atoi((char *)pump.lastread)) {
+                    digitalWrite(PINPUMP, HIGH);
+                    delay(500);
+                    digitalWrite(PINPUMP, LOW);
+                }
+            }
+        } else {
+            registerNode();
+        }
+    }
+
+    SystemSleepConfiguration config;
+    config.mode(SystemSleepMode::STOP).duration(SLEEP_S * 1000);
+    System.sleep(config);
+}
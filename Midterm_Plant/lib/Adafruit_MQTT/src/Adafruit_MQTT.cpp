@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 #include "Adafruit_MQTT.h"
+#include "Adafruit_MQTT_Router.h"
 
 #if defined(ARDUINO_SAMD_ZERO) || defined(ARDUINO_SAMD_MKR1000) || defined(SPARK)
 static char *dtostrf (double val, signed char width, unsigned char prec, char *sout) {
@@ -119,6 +120,28 @@ Adafruit_MQTT::Adafruit_MQTT(const char *server,
 
   packet_id_counter = 0;
 
+  bulkHead = bulkTail = bulkCount = 0;
+  bulkDropped = 0;
+
+  ratePerMinute = 0;
+  rateTokens = rateCapacity = 0;
+  rateRefilledAt = 0;
+  throttledUntil = 0;
+  throttleActive = false;
+  rxEmptyAt = 0;
+  rxBetweenPackets = false;
+  throttleFeed = 0;
+  publishesDeferred = 0;
+  publishesMerged = 0;
+  for (uint8_t i=0; i<MQTT_DEFER_SLOTS; i++) {
+    deferred[i].topic = 0;
+  }
+
+  srtt8 = 0;
+  rttvar4 = 0;
+  rto = 0;
+  rttSampleCount = 0;
+  timeoutsInARow = 0;
 }
 
 
@@ -144,6 +167,28 @@ Adafruit_MQTT::Adafruit_MQTT(const char *server,
 
   packet_id_counter = 0;
 
+  bulkHead = bulkTail = bulkCount = 0;
+  bulkDropped = 0;
+
+  ratePerMinute = 0;
+  rateTokens = rateCapacity = 0;
+  rateRefilledAt = 0;
+  throttledUntil = 0;
+  throttleActive = false;
+  rxEmptyAt = 0;
+  rxBetweenPackets = false;
+  throttleFeed = 0;
+  publishesDeferred = 0;
+  publishesMerged = 0;
+  for (uint8_t i=0; i<MQTT_DEFER_SLOTS; i++) {
+    deferred[i].topic = 0;
+  }
+
+  srtt8 = 0;
+  rttvar4 = 0;
+  rto = 0;
+  rttSampleCount = 0;
+  timeoutsInARow = 0;
 }
 
 int8_t Adafruit_MQTT::connect() {
@@ -155,9 +200,14 @@ int8_t Adafruit_MQTT::connect() {
   uint8_t len = connectPacket(buffer);
   if (!sendPacket(buffer, len))
     return -1;
+  uint32_t sent = millis();
 
   // Read connect response packet and verify it
-  len = readFullPacket(buffer, MAXBUFFERSIZE, CONNECT_TIMEOUT_MS);
+  len = readFullPacket(buffer, MAXBUFFERSIZE, responseTimeout(CONNECT_TIMEOUT_MS));
+  if (len == 0)
+    rttTimeout();
+  else
+    rttSample(millis() - sent);
   if (len != 4)
     return -1;
   if ((buffer[0] != (MQTT_CTRL_CONNECTACK << 4)) || (buffer[1] != 2))
@@ -176,6 +226,7 @@ int8_t Adafruit_MQTT::connect() {
       uint8_t len = subscribePacket(buffer, subscriptions[i]->topic, subscriptions[i]->qos);
       if (!sendPacket(buffer, len))
 	return -1;
+      uint32_t sent = millis();
 
       if(MQTT_PROTOCOL_LEVEL < 3) // older versions didn't suback
 	break;
@@ -185,10 +236,12 @@ int8_t Adafruit_MQTT::connect() {
       // Subscription before the Server sends the SUBACK Packet. (will really need to use callbacks - ada)
 
       //Serial.println("\t**looking for suback");
-      if (processPacketsUntil(buffer, MQTT_CTRL_SUBACK, SUBACK_TIMEOUT_MS)) {
+      if (processPacketsUntil(buffer, MQTT_CTRL_SUBACK, responseTimeout(SUBACK_TIMEOUT_MS))) {
+	rttSample(millis() - sent);
 	success = true;
 	break;
       }
+      rttTimeout();
       //Serial.println("\t**failed, retrying!");
     }
     if (! success) return -2; // failed to sub for some reason
@@ -215,7 +268,7 @@ uint16_t Adafruit_MQTT::processPacketsUntil(uint8_t *buffer, uint8_t waitforpack
       //DEBUG_PRINTLN(F("Found right packet")); 
       return len;
     } else {
-      ERROR_PRINTLN(F("Dropped a packet"));
+      ERROR_LOG(MQTT_LOG_DROPPED_PACKET, buffer[0] >> 4);
     }
   }
   return 0;
@@ -227,8 +280,11 @@ uint16_t Adafruit_MQTT::readFullPacket(uint8_t *buffer, uint16_t maxsize, uint16
 
   uint8_t rlen;
 
-  // read the packet type:
+  // read the packet type; until it shows up, an empty socket means the
+  // next packet hasn't arrived yet
+  rxBetweenPackets = true;
   rlen = readPacket(pbuff, 1, timeout);
+  rxBetweenPackets = false;
   if (rlen != 1) return 0;
 
   DEBUG_PRINT(F("Packet Type:\t")); DEBUG_PRINTBUFFER(pbuff, rlen);
@@ -294,19 +350,47 @@ bool Adafruit_MQTT::disconnect() {
 }
 
 
-bool Adafruit_MQTT::publish(const char *topic, const char *data, uint8_t qos) {
-    return publish(topic, (uint8_t*)(data), strlen(data), qos);
+bool Adafruit_MQTT::publish(const char *topic, const char *data, uint8_t qos,
+                            uint8_t priority) {
+    return publish(topic, (uint8_t*)(data), strlen(data), qos, priority);
+}
+
+bool Adafruit_MQTT::publish(const char *topic, uint8_t *data, uint16_t bLen, uint8_t qos,
+                            uint8_t priority) {
+  Adafruit_MQTT_PublishHeader header;
+  header.set(topic, qos);
+  return publish(header, data, bLen, priority);
 }
 
-bool Adafruit_MQTT::publish(const char *topic, uint8_t *data, uint16_t bLen, uint8_t qos) {
+bool Adafruit_MQTT::publish(const Adafruit_MQTT_PublishHeader &header, uint8_t *data,
+                            uint16_t bLen, uint8_t priority) {
+  uint8_t qos = header.qos;
+
+  // Out of tokens: park QoS 0 samples for later, QoS 1 callers get to retry.
+  if (ratePerMinute && !takeToken()) {
+    if (qos > 0)
+      return false;
+    return deferPublish(header.topic, data, bLen, priority);
+  }
+
   // Construct and send publish packet.
-  uint16_t len = publishPacket(buffer, topic, data, bLen, qos);
+  uint16_t len = publishPacket(buffer, header, data, bLen);
+
+  // Bulk QoS 0 goes to the back of the queue, serviceQueue() sends it.
+  if (priority == MQTT_PRIO_BULK && qos == 0)
+    return queueBulk(buffer, len);
+
   if (!sendPacket(buffer, len))
     return false;
 
   // If QOS level is high enough verify the response packet.
   if (qos > 0) {
-    len = readFullPacket(buffer, MAXBUFFERSIZE, PUBLISH_TIMEOUT_MS);
+    uint32_t sent = millis();
+    len = readFullPacket(buffer, MAXBUFFERSIZE, responseTimeout(PUBLISH_TIMEOUT_MS));
+    if (len == 0)
+      rttTimeout();
+    else
+      rttSample(millis() - sent);
     DEBUG_PRINT(F("Publish QOS1+ reply:\t"));
     DEBUG_PRINTBUFFER(buffer, len);
     if (len != 4)
@@ -387,7 +471,7 @@ bool Adafruit_MQTT::unsubscribe(Adafruit_MQTT_Subscribe *sub) {
       if(subscriptions[i]->qos > 0 && MQTT_PROTOCOL_LEVEL > 3) {
 
         // wait for UNSUBACK
-        len = readFullPacket(buffer, MAXBUFFERSIZE, CONNECT_TIMEOUT_MS);
+        len = readFullPacket(buffer, MAXBUFFERSIZE, responseTimeout(CONNECT_TIMEOUT_MS));
         DEBUG_PRINT(F("UNSUBACK:\t"));
         DEBUG_PRINTBUFFER(buffer, len);
 
@@ -415,7 +499,11 @@ void Adafruit_MQTT::processPackets(int16_t timeout) {
     Adafruit_MQTT_Subscribe *sub = readSubscription(timeout - elapsed);
     if (sub) {
       //Serial.println("**** sub packet received");
-      if (sub->callback_uint32t != NULL) {
+      if (sub->dispatch_hook != NULL) {
+        // typed callback, payload was already parsed on arrival
+        sub->dispatch_hook(sub);
+      }
+      else if (sub->callback_uint32t != NULL) {
 	// huh lets do the callback in integer mode
 	uint32_t data = 0;
 	data = atoi((char *)sub->lastread);
@@ -453,15 +541,34 @@ void Adafruit_MQTT::processPackets(int16_t timeout) {
 Adafruit_MQTT_Subscribe *Adafruit_MQTT::readSubscription(int16_t timeout) {
   uint16_t i, topiclen, datalen;
 
+  // Nothing waiting and no time to wait: don't go into the transport's
+  // read loop at all.  A transport that can't tell gets this pass as the
+  // receipt time.
+  int waiting = bytesAvailable();
+  if (waiting <= 0) {
+    rxEmptyAt = micros();
+    if (waiting == 0 && timeout <= 0)
+      return NULL;
+  }
+
   // Check if data is available to read.
   uint16_t len = readFullPacket(buffer, MAXBUFFERSIZE, timeout); // return one full packet
   if (!len)
     return NULL;  // No data available, just quit.
+  uint32_t arrived = rxEmptyAt;
+  // drained: whatever is read next arrived after this
+  if (bytesAvailable() == 0)
+    rxEmptyAt = micros();
   DEBUG_PRINT("Packet len: "); DEBUG_PRINTLN(len); 
   DEBUG_PRINTBUFFER(buffer, len);
 
-  // Parse out length of packet.
-  topiclen = buffer[3];
+  // Skip the remaining length, one to four bytes, to the topic length.
+  uint8_t *topic = buffer + 1;
+  while ((*topic & 0x80) && topic < buffer + 4)
+    topic++;
+  topic++;
+  topiclen = (topic[0] << 8) | topic[1];
+  topic += 2;
   DEBUG_PRINT(F("Looking for subscription len ")); DEBUG_PRINTLN(topiclen);
 
   // Find subscription associated with this packet.
@@ -473,7 +580,7 @@ Adafruit_MQTT_Subscribe *Adafruit_MQTT::readSubscription(int16_t timeout) {
         continue;
       // Stop if the subscription topic matches the received topic. Be careful
       // to make comparison case insensitive.
-      if (strncasecmp((char*)buffer+4, subscriptions[i]->topic, topiclen) == 0) {
+      if (strncasecmp((char*)topic, subscriptions[i]->topic, topiclen) == 0) {
         DEBUG_PRINT(F("Found sub #")); DEBUG_PRINTLN(i);
         break;
       }
@@ -486,24 +593,37 @@ Adafruit_MQTT_Subscribe *Adafruit_MQTT::readSubscription(int16_t timeout) {
   // Check if it is QoS 1, TODO: we dont support QoS 2
   if ((buffer[0] & 0x6) == 0x2) {
     packet_id_len = 2;
-    packetid = buffer[topiclen+4];
+    packetid = topic[topiclen];
     packetid <<= 8;
-    packetid |= buffer[topiclen+5];
+    packetid |= topic[topiclen+1];
   }
 
   // zero out the old data
   memset(subscriptions[i]->lastread, 0, SUBSCRIPTIONDATALEN);
 
-  datalen = len - topiclen - packet_id_len - 4;
+  uint8_t *data = topic + topiclen + packet_id_len;
+  if (data > buffer + len)
+    return NULL;  // cut short
+  datalen = len - (data - buffer);
+
+  // throttle messages are longer than lastread, look at the whole thing
+  if (subscriptions[i] == throttleFeed)
+    handleThrottle(data, datalen);
+
   if (datalen > SUBSCRIPTIONDATALEN) {
     datalen = SUBSCRIPTIONDATALEN-1; // cut it off
   }
   // extract out just the data, into the subscription object itself
-  memmove(subscriptions[i]->lastread, buffer+4+topiclen+packet_id_len, datalen);
+  memmove(subscriptions[i]->lastread, data, datalen);
   subscriptions[i]->datalen = datalen;
+  subscriptions[i]->received_us = arrived;
   DEBUG_PRINT(F("Data len: ")); DEBUG_PRINTLN(datalen);
   DEBUG_PRINT(F("Data: ")); DEBUG_PRINTLN((char *)subscriptions[i]->lastread);
 
+  // typed subscriptions parse the payload exactly once, here
+  if (subscriptions[i]->parse_hook)
+    subscriptions[i]->parse_hook(subscriptions[i]);
+
   if ((MQTT_PROTOCOL_LEVEL > 3) &&(buffer[0] & 0x6) == 0x2) {
     uint8_t ackpacket[4];
     
@@ -531,16 +651,217 @@ bool Adafruit_MQTT::ping(uint8_t num) {
     uint8_t len = pingPacket(buffer);
     if (!sendPacket(buffer, len))
       continue;
+    uint32_t sent = millis();
 
     // Process ping reply.
-    len = processPacketsUntil(buffer, MQTT_CTRL_PINGRESP, PING_TIMEOUT_MS);
-    if (buffer[0] == (MQTT_CTRL_PINGRESP << 4))
+    len = processPacketsUntil(buffer, MQTT_CTRL_PINGRESP, responseTimeout(PING_TIMEOUT_MS));
+    if (len && buffer[0] == (MQTT_CTRL_PINGRESP << 4)) {
+      rttSample(millis() - sent);
       return true;
+    }
+    rttTimeout();
   }
 
   return false;
 }
 
+// Outbound bulk queue /////////////////////////////////////////////////////////
+
+bool Adafruit_MQTT::queueBulk(uint8_t *packet, uint16_t len) {
+  if (len + 2 > MQTT_BULK_QUEUESIZE - bulkCount) {
+    DEBUG_PRINTLN(F("Bulk queue full, dropping packet"));
+    bulkDropped++;
+    return false;
+  }
+  uint8_t hdr[2] = { (uint8_t)(len >> 8), (uint8_t)(len & 0xFF) };
+  for (uint8_t i=0; i<2; i++) {
+    bulkQueue[bulkHead] = hdr[i];
+    bulkHead = (bulkHead + 1) % MQTT_BULK_QUEUESIZE;
+  }
+  uint16_t first = min(len, (uint16_t)(MQTT_BULK_QUEUESIZE - bulkHead));
+  memcpy(bulkQueue + bulkHead, packet, first);
+  memcpy(bulkQueue, packet + first, len - first);
+  bulkHead = (bulkHead + len) % MQTT_BULK_QUEUESIZE;
+  bulkCount += len + 2;
+  return true;
+}
+
+void Adafruit_MQTT::bulkCopy(uint8_t *dest, uint16_t pos, uint16_t len) {
+  uint16_t first = min(len, (uint16_t)(MQTT_BULK_QUEUESIZE - pos));
+  memcpy(dest, bulkQueue + pos, first);
+  memcpy(dest + first, bulkQueue, len - first);
+}
+
+uint16_t Adafruit_MQTT::serviceQueue(uint16_t budget) {
+  if (!connected())
+    return bulkCount;
+
+  flushDeferred();
+
+  uint16_t sent = 0;
+  while (bulkCount > 0) {
+    uint8_t hdr[2];
+    bulkCopy(hdr, bulkTail, 2);
+    uint16_t len = (hdr[0] << 8) | hdr[1];
+
+    // always make progress, even if one packet is bigger than the budget
+    if (sent > 0 && sent + len > budget)
+      break;
+
+    bulkCopy(buffer, (bulkTail + 2) % MQTT_BULK_QUEUESIZE, len);
+    if (!sendPacket(buffer, len))
+      break;  // leave it queued for next time
+
+    bulkTail = (bulkTail + len + 2) % MQTT_BULK_QUEUESIZE;
+    bulkCount -= len + 2;
+    sent += len;
+  }
+  if (bulkCount == 0)
+    bulkHead = bulkTail = 0;
+  return bulkCount;
+}
+
+// Publish rate limiting ///////////////////////////////////////////////////////
+
+// ms per minute, so a token is earned after 60000 / perMinute ms exactly
+#define MQTT_RATE_TOKEN 60000UL
+
+void Adafruit_MQTT::setRateLimit(uint16_t perMinute, uint8_t burst) {
+  ratePerMinute = perMinute;
+  rateCapacity = (burst ? burst : 1) * MQTT_RATE_TOKEN;
+  rateTokens = rateCapacity;
+  rateRefilledAt = millis();
+}
+
+bool Adafruit_MQTT::takeToken() {
+  uint32_t now = millis();
+  if (throttled()) {
+    rateRefilledAt = now;
+    return false;
+  }
+
+  // a minute refills any bucket, and keeps elapsed * perMinute in range
+  uint32_t elapsed = now - rateRefilledAt;
+  if (elapsed > 60000UL) elapsed = 60000UL;
+  rateTokens += elapsed * ratePerMinute;
+  if (rateTokens > rateCapacity) rateTokens = rateCapacity;
+  rateRefilledAt = now;
+
+  if (rateTokens < MQTT_RATE_TOKEN)
+    return false;
+  rateTokens -= MQTT_RATE_TOKEN;
+  return true;
+}
+
+void Adafruit_MQTT::handleThrottle(const uint8_t *msg, uint16_t len) {
+  // Adafruit IO sends e.g. "user data rate limit reached, 23 seconds until
+  // throttle released".  Use the number in front of "second" if there is one.
+  uint32_t wait = MQTT_THROTTLE_DEFAULT_MS;
+  for (uint16_t i=0; i+7 <= len; i++) {
+    if (strncasecmp((const char *)msg + i, " second", 7) != 0)
+      continue;
+    uint32_t secs = 0, mult = 1;
+    int16_t j = i - 1;
+    while (j >= 0 && isdigit(msg[j]) && mult <= 100000) {
+      secs += (msg[j] - '0') * mult;
+      mult *= 10;
+      j--;
+    }
+    if (mult > 1)
+      wait = secs * 1000UL;
+    break;
+  }
+  ERROR_LOG(MQTT_LOG_THROTTLED, wait);
+  throttledUntil = millis() + wait;
+  throttleActive = true;
+  rateTokens = 0;
+}
+
+bool Adafruit_MQTT::deferPublish(const char *topic, uint8_t *data, uint16_t len,
+                                 uint8_t priority) {
+  if (len > MQTT_DEFER_PAYLOADLEN) {
+    DEBUG_PRINTLN(F("Sample too big to defer, dropping"));
+    return false;
+  }
+
+  // latest sample for a topic wins
+  int8_t slot = -1;
+  for (uint8_t i=0; i<MQTT_DEFER_SLOTS; i++) {
+    if (deferred[i].topic == topic) {
+      slot = i;
+      publishesMerged++;
+      break;
+    }
+    if (slot < 0 && deferred[i].topic == 0)
+      slot = i;
+  }
+  if (slot < 0) {
+    DEBUG_PRINTLN(F("No free defer slot, dropping sample"));
+    return false;
+  }
+
+  deferred[slot].topic = topic;
+  deferred[slot].priority = priority;
+  deferred[slot].len = len;
+  memcpy(deferred[slot].payload, data, len);
+  publishesDeferred++;
+  return true;
+}
+
+void Adafruit_MQTT::flushDeferred() {
+  for (uint8_t i=0; i<MQTT_DEFER_SLOTS; i++) {
+    if (deferred[i].topic == 0)
+      continue;
+    if (!takeToken())
+      return;
+    uint16_t len = publishPacket(buffer, deferred[i].topic, deferred[i].payload,
+                                 deferred[i].len, 0);
+    bool ok = (deferred[i].priority == MQTT_PRIO_BULK) ? queueBulk(buffer, len)
+                                                       : sendPacket(buffer, len);
+    if (!ok)
+      return;  // keep it for next time; the token is spent either way
+    deferred[i].topic = 0;
+  }
+}
+
+// Round trip estimation /////////////////////////////////////////////////////
+
+// Same scheme as TCP (RFC 6298): srtt and rttvar are kept scaled by 8 and 4
+// so the 1/8 and 1/4 gains are plain shifts.
+void Adafruit_MQTT::rttSample(uint32_t ms) {
+  if (rttSampleCount == 0) {
+    srtt8 = ms << 3;
+    rttvar4 = ms << 1;  // rttvar = ms/2
+  } else {
+    int32_t err = (int32_t)ms - (int32_t)(srtt8 >> 3);
+    srtt8 += err;  // srtt += err/8
+    if (err < 0) err = -err;
+    rttvar4 += err - (rttvar4 >> 2);  // rttvar += (|err| - rttvar)/4
+  }
+  rttSampleCount++;
+  timeoutsInARow = 0;
+
+  uint32_t t = (srtt8 >> 3) + rttvar4;  // srtt + 4*rttvar
+  if (t < MQTT_RTO_MIN_MS) t = MQTT_RTO_MIN_MS;
+  if (t > MQTT_RTO_MAX_MS) t = MQTT_RTO_MAX_MS;
+  rto = t;
+  DEBUG_PRINT(F("RTT ")); DEBUG_PRINT(ms); DEBUG_PRINT(F(" ms, timeout ")); DEBUG_PRINTLN(rto);
+}
+
+void Adafruit_MQTT::rttTimeout() {
+  if (timeoutsInARow < 255)
+    timeoutsInARow++;
+  // back off until a response makes it through again
+  if (rttSampleCount > 0) {
+    uint32_t t = (uint32_t)rto * 2;
+    rto = t > MQTT_RTO_MAX_MS ? MQTT_RTO_MAX_MS : t;
+  }
+}
+
+uint16_t Adafruit_MQTT::responseTimeout(uint16_t fallback) {
+  return rttSampleCount ? rto : fallback;
+}
+
 // Packet Generation Functions /////////////////////////////////////////////////
 
 // The current MQTT spec is 3.1.1 and available here:
@@ -635,19 +956,18 @@ uint8_t Adafruit_MQTT::connectPacket(uint8_t *packet) {
 // as per http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html#_Toc398718040
 uint16_t Adafruit_MQTT::publishPacket(uint8_t *packet, const char *topic,
                                      uint8_t *data, uint16_t bLen, uint8_t qos) {
-  uint8_t *p = packet;
-  uint16_t len=0;
+  Adafruit_MQTT_PublishHeader header;
+  header.set(topic, qos);
+  return publishPacket(packet, header, data, bLen);
+}
 
-  // calc length of non-header data
-  len += 2;               // two bytes to set the topic size
-  len += strlen(topic); // topic length
-  if(qos > 0) { 
-    len += 2; // qos packet id
-  }
-  len += bLen; // payload length
+uint16_t Adafruit_MQTT::publishPacket(uint8_t *packet, const Adafruit_MQTT_PublishHeader &header,
+                                     uint8_t *data, uint16_t bLen) {
+  uint8_t *p = packet;
+  uint16_t len = header.baseLen + bLen;  // topic, packet id and payload
 
   // Now you can start generating the packet!
-  p[0] = MQTT_CTRL_PUBLISH << 4 | qos << 1;
+  p[0] = header.flags;
   p++;
 
   // fill in packet[1] last
@@ -663,10 +983,13 @@ uint16_t Adafruit_MQTT::publishPacket(uint8_t *packet, const char *topic,
   } while ( len > 0 );
 
   // topic comes before packet identifier
-  p = stringprint(p, topic);
+  p[0] = header.topicLen >> 8;
+  p[1] = header.topicLen & 0xFF;
+  memcpy(p + 2, header.topic, header.topicLen);
+  p += 2 + header.topicLen;
 
   // add packet identifier. used for checking PUBACK in QOS > 0
-  if(qos > 0) {
+  if(header.qos > 0) {
     p[0] = (packet_id_counter >> 8) & 0xFF;
     p[1] = packet_id_counter & 0xFF;
     p+=2;
@@ -772,42 +1095,57 @@ uint8_t Adafruit_MQTT::disconnectPacket(uint8_t *packet) {
 Adafruit_MQTT_Publish::Adafruit_MQTT_Publish(Adafruit_MQTT *mqttserver,
                                              const char *feed, uint8_t q) {
   mqtt = mqttserver;
-  topic = feed;
-  qos = q;
+  router = 0;
+  header.set(feed, q);
+  priority = MQTT_PRIO_CONTROL;
+}
+
+Adafruit_MQTT_Publish::Adafruit_MQTT_Publish(Adafruit_MQTT_Router *r,
+                                             const char *feed, uint8_t q) {
+  mqtt = 0;
+  router = r;
+  header.set(feed, q);
+  priority = MQTT_PRIO_CONTROL;
+}
+
+bool Adafruit_MQTT_Publish::send(uint8_t *payload, uint16_t bLen) {
+  if (router)
+    return router->publish(header, payload, bLen, priority);
+  return mqtt->publish(header, payload, bLen, priority);
 }
 
 bool Adafruit_MQTT_Publish::publish(int i) {
   char payload[12];
   ltoa(i, payload, 10);
-  return mqtt->publish(topic, payload, qos);
+  return send((uint8_t *)payload, strlen(payload));
 }
 
-bool Adafruit_MQTT_Publish::publish(int32_t i) {
-  char payload[12];
+bool Adafruit_MQTT_Publish::publish(long i) {
+  char payload[3 * sizeof(long) + 2];
   ltoa(i, payload, 10);
-  return mqtt->publish(topic, payload, qos);
+  return send((uint8_t *)payload, strlen(payload));
 }
 
 bool Adafruit_MQTT_Publish::publish(uint32_t i) {
   char payload[11];
   ultoa(i, payload, 10);
-  return mqtt->publish(topic, payload, qos);
+  return send((uint8_t *)payload, strlen(payload));
 }
 
 bool Adafruit_MQTT_Publish::publish(double f, uint8_t precision) {
   char payload[41];  // Need to technically hold float max, 39 digits and minus sign.
   dtostrf(f, 0, precision, payload);
-  return mqtt->publish(topic, payload, qos);
+  return send((uint8_t *)payload, strlen(payload));
 }
 
 bool Adafruit_MQTT_Publish::publish(const char *payload) {
-  return mqtt->publish(topic, payload, qos);
+  return send((uint8_t *)payload, strlen(payload));
 }
 
 //publish buffer of arbitrary length
 bool Adafruit_MQTT_Publish::publish(uint8_t *payload, uint16_t bLen) {
 
-  return mqtt->publish(topic, payload, bLen, qos);
+  return send(payload, bLen);
 }
 
 
@@ -819,10 +1157,13 @@ Adafruit_MQTT_Subscribe::Adafruit_MQTT_Subscribe(Adafruit_MQTT *mqttserver,
   topic = feed;
   qos = q;
   datalen = 0;
+  received_us = 0;
   callback_uint32t = 0;
   callback_buffer = 0;
   callback_double = 0;
   callback_io = 0;
+  parse_hook = 0;
+  dispatch_hook = 0;
   io_feed = 0;
 }
 
@@ -71,6 +71,15 @@
   #define ERROR_PRINTBUFFER(buffer, len) {}
 #endif
 
+// Errors on the hot path go to the deferred log instead of DEBUG_PRINTER,
+// see Adafruit_MQTT_Log.h.  Takes an event id and up to three integers.
+#ifdef MQTT_ERROR
+  #include "Adafruit_MQTT_Log.h"
+  #define ERROR_LOG(...) { mqttLog.log(__VA_ARGS__); }
+#else
+  #define ERROR_LOG(...) {}
+#endif
+
 // Use 3 (MQTT 3.0) or 4 (MQTT 3.1.1)
 #define MQTT_PROTOCOL_LEVEL 4
 
@@ -97,6 +106,16 @@
 #define PING_TIMEOUT_MS    500
 #define SUBACK_TIMEOUT_MS  500
 
+// Adaptive timeouts.  Round trips to the broker (CONNECT/CONNACK,
+// PINGREQ/PINGRESP, PUBLISH/PUBACK, SUBSCRIBE/SUBACK) are timed and the
+// response timeout is derived from the smoothed RTT and its variance the
+// same way TCP computes its RTO.  The fixed timeouts above are only used
+// until the first round trip has been measured.
+#define MQTT_RTO_MIN_MS 200
+#define MQTT_RTO_MAX_MS 10000
+// This many timeouts in a row and the link is considered dead.
+#define MQTT_DEAD_LINK_TIMEOUTS 3
+
 // Adjust as necessary, in seconds.  Default to 5 minutes.
 #define MQTT_CONN_KEEPALIVE 300
 
@@ -113,6 +132,32 @@
 #define MQTT_CONN_WILLFLAG        0x04
 #define MQTT_CONN_CLEANSESSION    0x02
 
+// Outbound priority classes.  Control traffic (acks, pings, connect and
+// subscribe, anything published with MQTT_PRIO_CONTROL) is sent right away.
+// Bulk publishes are queued and drained by serviceQueue() at most
+// MQTT_BULK_BUDGET bytes per call, so control packets never sit behind a
+// telemetry backlog.  QoS 1 publishes wait for their PUBACK and are always
+// sent right away.
+#define MQTT_PRIO_CONTROL 0
+#define MQTT_PRIO_BULK    1
+
+// Bytes of queued bulk packets, kept across disconnects.
+#define MQTT_BULK_QUEUESIZE 512
+// Bytes of bulk traffic serviceQueue() sends per call by default.
+#define MQTT_BULK_BUDGET 256
+
+// Publish rate limiting.  Adafruit IO allows a fixed number of data points
+// per minute per account (30 on free accounts, 60 on IO+) and throttles,
+// then bans, clients that go over.  With setRateLimit() every publish takes
+// a token from a bucket that refills at that rate.  QoS 0 samples that
+// arrive with the bucket empty are parked in one slot per topic, a newer
+// sample replacing the older one, and sent by serviceQueue() once tokens
+// are available again.
+#define MQTT_DEFER_SLOTS      5
+#define MQTT_DEFER_PAYLOADLEN 24
+// Pause used when the throttle message doesn't say how long to wait.
+#define MQTT_THROTTLE_DEFAULT_MS 60000
+
 // how many subscriptions we want to be able to track
 #define MAXSUBSCRIPTIONS 5
 
@@ -121,6 +166,7 @@
 #define SUBSCRIPTIONDATALEN 20
 
 class AdafruitIO_Feed;  // forward decl
+class Adafruit_MQTT_Router;  // forward decl
 
 //Function pointer that returns an int
 typedef void (*SubscribeCallbackUInt32Type)(uint32_t);
@@ -135,6 +181,29 @@ extern void printBuffer(uint8_t *buffer, uint16_t len);
 
 class Adafruit_MQTT_Subscribe;  // forward decl
 
+// hooks used by Adafruit_MQTT_TypedSubscribe
+typedef void (*SubscribeTypedHookType)(Adafruit_MQTT_Subscribe *sub);
+
+// The parts of a PUBLISH packet that only depend on the topic and QoS.
+// Adafruit_MQTT_Publish works this out once in its constructor, so each
+// publish only encodes the remaining length, patches in the packet id and
+// copies the topic and payload.
+struct Adafruit_MQTT_PublishHeader {
+  const char *topic;
+  uint16_t topicLen;
+  uint16_t baseLen;  // remaining length without the payload
+  uint8_t flags;     // first byte, packet type and QoS
+  uint8_t qos;
+
+  void set(const char *t, uint8_t q) {
+    topic = t;
+    topicLen = strlen(t);
+    qos = q;
+    flags = MQTT_CTRL_PUBLISH << 4 | q << 1;
+    baseLen = 2 + topicLen + (q > 0 ? 2 : 0);
+  }
+};
+
 class Adafruit_MQTT {
  public:
   Adafruit_MQTT(const char *server,
@@ -182,8 +251,39 @@ class Adafruit_MQTT {
 
   // Publish a message to a topic using the specified QoS level.  Returns true
   // if the message was published, false otherwise.
-  bool publish(const char *topic, const char *payload, uint8_t qos = 0);
-  bool publish(const char *topic, uint8_t *payload, uint16_t bLen, uint8_t qos = 0);
+  bool publish(const char *topic, const char *payload, uint8_t qos = 0,
+               uint8_t priority = MQTT_PRIO_CONTROL);
+  bool publish(const char *topic, uint8_t *payload, uint16_t bLen, uint8_t qos = 0,
+               uint8_t priority = MQTT_PRIO_CONTROL);
+  bool publish(const Adafruit_MQTT_PublishHeader &header, uint8_t *payload, uint16_t bLen,
+               uint8_t priority = MQTT_PRIO_CONTROL);
+
+  // Send queued bulk packets, up to budget bytes (at least one packet is
+  // always sent if any is waiting).  Call once per loop.  Returns the number
+  // of bytes still queued.
+  uint16_t serviceQueue(uint16_t budget = MQTT_BULK_BUDGET);
+  uint16_t bulkQueued() { return bulkCount; }
+  // Bulk packets that didn't fit in the queue.
+  uint32_t bulkDropped;
+
+  // Limit publishes to perMinute, allowing bursts of up to burst messages.
+  // A perMinute of 0 (the default) turns the limiter off.
+  void setRateLimit(uint16_t perMinute, uint8_t burst = 1);
+  // Subscription to the broker's throttle topic (<username>/throttle on
+  // Adafruit IO).  A message there empties the bucket and pauses publishing
+  // for as long as it says.
+  void setThrottleFeed(Adafruit_MQTT_Subscribe *sub) { throttleFeed = sub; }
+  bool throttled() {
+    // the deadline only counts while a throttle is on: compared against
+    // a stale one, the signed difference flips every 2^31 ms of uptime
+    if (throttleActive && (int32_t)(throttledUntil - millis()) <= 0)
+      throttleActive = false;
+    return throttleActive;
+  }
+  // Samples parked while out of tokens, and how many of those replaced an
+  // older sample that never went out.
+  uint32_t publishesDeferred;
+  uint32_t publishesMerged;
 
   // Add a subscription to receive messages for a topic.  Returns true if the
   // subscription could be added or was already present, false otherwise.
@@ -205,6 +305,15 @@ class Adafruit_MQTT {
   // Ping the server to ensure the connection is still alive.
   bool ping(uint8_t n = 1);
 
+  // Round trip estimates, in milliseconds.  timeoutMs() is the timeout
+  // currently used when waiting for a broker response.
+  uint32_t rttSmoothedMs() { return srtt8 >> 3; }
+  uint32_t rttVarianceMs() { return rttvar4 >> 2; }
+  uint16_t timeoutMs() { return rto; }
+  uint32_t rttSamples() { return rttSampleCount; }
+  // True once MQTT_DEAD_LINK_TIMEOUTS responses in a row never arrived.
+  bool deadLink() { return timeoutsInARow >= MQTT_DEAD_LINK_TIMEOUTS; }
+
  protected:
   // Interface that subclasses need to implement:
 
@@ -222,6 +331,20 @@ class Adafruit_MQTT {
   // milliseconds) for data to be available. 
   virtual uint16_t readPacket(uint8_t *buffer, uint16_t maxlen, int16_t timeout) = 0;
 
+  // Bytes waiting to be read right now, without blocking, or -1 if the
+  // transport can't tell.  readSubscription() returns straight away when
+  // this is 0 and there's no time to wait.
+  virtual int bytesAvailable() { return -1; }
+
+  // Receipt time for subscriptions: micros() when the transport last saw
+  // nothing waiting while it was between packets.  The next packet arrived
+  // after that, so latency measured from it is an upper bound, exact to
+  // within one poll.  Transports call rxIdle() whenever a read finds
+  // nothing waiting.
+  void rxIdle() { if (rxBetweenPackets) rxEmptyAt = micros(); }
+  uint32_t rxEmptyAt;
+  bool rxBetweenPackets;
+
   // Read a full packet, keeping note of the correct length
   uint16_t readFullPacket(uint8_t *buffer, uint16_t maxsize, uint16_t timeout);
   // Properly process packets until you get to one you want
@@ -240,39 +363,91 @@ class Adafruit_MQTT {
   uint8_t buffer[MAXBUFFERSIZE];  // one buffer, used for all incoming/outgoing
   uint16_t packet_id_counter;
 
- private:
-  Adafruit_MQTT_Subscribe *subscriptions[MAXSUBSCRIPTIONS];
-
-  void    flushIncoming(uint16_t timeout);
+  // Feed round trip measurements into the timeout estimate.
+  void rttSample(uint32_t ms);
+  void rttTimeout();
+  uint16_t responseTimeout(uint16_t fallback);
 
-  // Functions to generate MQTT packets.
+  // Functions to generate MQTT packets.  Protected so a transport that
+  // can't wait for the broker's answer can send them itself.
   uint8_t connectPacket(uint8_t *packet);
   uint8_t disconnectPacket(uint8_t *packet);
   uint16_t publishPacket(uint8_t *packet, const char *topic, uint8_t *payload, uint16_t bLen, uint8_t qos);
+  uint16_t publishPacket(uint8_t *packet, const Adafruit_MQTT_PublishHeader &header,
+                         uint8_t *payload, uint16_t bLen);
   uint8_t subscribePacket(uint8_t *packet, const char *topic, uint8_t qos);
   uint8_t unsubscribePacket(uint8_t *packet, const char *topic);
   uint8_t pingPacket(uint8_t *packet);
   uint8_t pubackPacket(uint8_t *packet, uint16_t packetid);
+
+ private:
+  Adafruit_MQTT_Subscribe *subscriptions[MAXSUBSCRIPTIONS];
+
+  // bulk queue, a ring of [len hi][len lo][packet] records
+  uint8_t bulkQueue[MQTT_BULK_QUEUESIZE];
+  uint16_t bulkHead, bulkTail, bulkCount;
+  bool queueBulk(uint8_t *packet, uint16_t len);
+  void bulkCopy(uint8_t *dest, uint16_t pos, uint16_t len);
+
+  // publish token bucket.  A token is MQTT_RATE_TOKEN units and a
+  // millisecond earns ratePerMinute of them, so refills are exact however
+  // often takeToken() runs.
+  uint16_t ratePerMinute;
+  uint32_t rateTokens, rateCapacity;
+  uint32_t rateRefilledAt;
+  uint32_t throttledUntil;
+  bool throttleActive;
+  Adafruit_MQTT_Subscribe *throttleFeed;
+  bool takeToken();
+  void handleThrottle(const uint8_t *msg, uint16_t len);
+
+  // newest unsent sample per topic while out of tokens
+  struct {
+    const char *topic;
+    uint8_t priority;
+    uint8_t len;
+    uint8_t payload[MQTT_DEFER_PAYLOADLEN];
+  } deferred[MQTT_DEFER_SLOTS];
+  bool deferPublish(const char *topic, uint8_t *data, uint16_t len, uint8_t priority);
+  void flushDeferred();
+
+  uint32_t srtt8;     // smoothed RTT, scaled by 8
+  uint32_t rttvar4;   // RTT mean deviation, scaled by 4
+  uint16_t rto;
+  uint32_t rttSampleCount;
+  uint8_t timeoutsInARow;
+
+  void    flushIncoming(uint16_t timeout);
 };
 
 
 class Adafruit_MQTT_Publish {
  public:
   Adafruit_MQTT_Publish(Adafruit_MQTT *mqttserver, const char *feed, uint8_t qos = 0);
+  // Publish through a router, to whichever brokers the feed is routed to.
+  Adafruit_MQTT_Publish(Adafruit_MQTT_Router *router, const char *feed, uint8_t qos = 0);
+
+  // MQTT_PRIO_CONTROL (default) or MQTT_PRIO_BULK for telemetry.
+  void setPriority(uint8_t p) { priority = p; }
 
   bool publish(const char *s);
   bool publish(double f, uint8_t precision=2);  // Precision controls the minimum number of digits after decimal.
                                                 // This might be ignored and a higher precision value sent.
   bool publish(int i);
-  bool publish(int32_t i);
+  // int32_t on the device; spelled long so it doesn't repeat publish(int)
+  // where int32_t is int
+  bool publish(long i);
   bool publish(uint32_t i);
   bool publish(uint8_t *b, uint16_t bLen);
 
 
 private:
+  bool send(uint8_t *payload, uint16_t bLen);
+
   Adafruit_MQTT *mqtt;
-  const char *topic;
-  uint8_t qos;
+  Adafruit_MQTT_Router *router;
+  Adafruit_MQTT_PublishHeader header;
+  uint8_t priority;
 };
 
 class Adafruit_MQTT_Subscribe {
@@ -292,12 +467,22 @@ class Adafruit_MQTT_Subscribe {
   // Number valid bytes in lastread. Limited to SUBSCRIPTIONDATALEN-1 to
   // ensure nul terminating lastread.
   uint16_t datalen;
+  // micros() when the client last saw its socket empty before this
+  // message, so the message arrived no earlier: (now - received_us) is an
+  // upper bound on how long it has been waiting, including time spent
+  // before anything polled the socket.
+  uint32_t received_us;
 
   SubscribeCallbackUInt32Type callback_uint32t;
   SubscribeCallbackDoubleType callback_double;
   SubscribeCallbackBufferType callback_buffer;
   SubscribeCallbackIOType     callback_io;
 
+  // Set by Adafruit_MQTT_TypedSubscribe.  parse_hook runs once when a
+  // message arrives, dispatch_hook from processPackets().
+  SubscribeTypedHookType      parse_hook;
+  SubscribeTypedHookType      dispatch_hook;
+
   AdafruitIO_Feed *io_feed;
 
  private:
@@ -0,0 +1,395 @@
+#include "Adafruit_MQTTSN.h"
+
+// Adafruit_MQTTSN Definition //////////////////////////////////////////////////
+
+Adafruit_MQTTSN::Adafruit_MQTTSN(UDP *u, IPAddress gw, uint16_t p, const char *cid,
+                                 uint16_t local) {
+  udp = u;
+  gateway = gw;
+  port = p;
+  localPort = local ? local : p;
+  udpStarted = false;
+  clientid = cid;
+  state = STATE_DISCONNECTED;
+  msgIdCounter = 0;
+  sessionCounter = 0;
+
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    subscriptions[i] = 0;
+  }
+}
+
+uint16_t Adafruit_MQTTSN::nextMsgId() {
+  // 0 is reserved for QoS -1
+  if (++msgIdCounter == 0)
+    msgIdCounter = 1;
+  return msgIdCounter;
+}
+
+bool Adafruit_MQTTSN::sendPacket(const uint8_t *packet, uint8_t len) {
+  if (!udpStarted) {
+    udp->begin(localPort);
+    udpStarted = true;
+  }
+  DEBUG_PRINT(F("MQTT-SN send:\t")); DEBUG_PRINTBUFFER((uint8_t *)packet, len);
+  int ret = udp->sendPacket(packet, len, gateway, port);
+  return ret == len;
+}
+
+uint8_t Adafruit_MQTTSN::readPacket(uint8_t *packet, int16_t timeout) {
+  if (!udpStarted)
+    return 0;
+
+  while (timeout >= 0) {
+    int len = udp->receivePacket(packet, MQTTSN_MAXPACKET);
+    // one byte length field only, and it has to match the datagram
+    if (len >= 2 && packet[0] == len) {
+      DEBUG_PRINT(F("MQTT-SN read:\t")); DEBUG_PRINTBUFFER(packet, len);
+      return len;
+    }
+    timeout -= MQTTSN_READINTERVAL_MS;
+    delay(MQTTSN_READINTERVAL_MS);
+  }
+  return 0;
+}
+
+uint8_t Adafruit_MQTTSN::awaitPacket(uint8_t type, uint16_t msgId, int16_t timeout) {
+  uint32_t start = millis();
+  while ((int32_t)(millis() - start) <= timeout) {
+    uint8_t len = readPacket(buffer, timeout - (millis() - start));
+    if (!len)
+      break;
+    uint8_t got = buffer[1];
+    if (got == MQTTSN_PUBLISH) {
+      handlePublish(buffer, len);
+      continue;
+    }
+    if (got != type)
+      continue;
+
+    // match the message id where the reply carries one
+    uint16_t id = 0;
+    if ((type == MQTTSN_PUBACK || type == MQTTSN_REGACK) && len >= 7)
+      id = (buffer[4] << 8) | buffer[5];
+    else if (type == MQTTSN_SUBACK && len >= 8)
+      id = (buffer[5] << 8) | buffer[6];
+    if (msgId && id && id != msgId)
+      continue;
+    return len;
+  }
+  return 0;
+}
+
+int8_t Adafruit_MQTTSN::connect() {
+  uint8_t cidlen = strlen(clientid);
+  if (cidlen > MQTTSN_MAXPACKET - 6)
+    cidlen = MQTTSN_MAXPACKET - 6;
+
+  uint8_t *p = buffer;
+  p[0] = 6 + cidlen;
+  p[1] = MQTTSN_CONNECT;
+  p[2] = MQTTSN_FLAG_CLEANSESSION;
+  p[3] = MQTTSN_PROTOCOL_ID;
+  p[4] = MQTTSN_KEEPALIVE >> 8;
+  p[5] = MQTTSN_KEEPALIVE & 0xFF;
+  memcpy(p + 6, clientid, cidlen);
+
+  int8_t rc = -1;
+  for (uint8_t retry=0; retry<MQTTSN_RETRIES && rc == -1; retry++) {
+    if (!sendPacket(buffer, 6 + cidlen))
+      continue;
+    if (awaitPacket(MQTTSN_CONNACK, 0, MQTTSN_TIMEOUT_MS) >= 3)
+      rc = buffer[2];
+  }
+  if (rc != 0)
+    return rc;
+
+  state = STATE_ACTIVE;
+  sessionCounter++;
+
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    if (subscriptions[i] && !subscribeTopic(subscriptions[i]))
+      return 2;
+  }
+  return 0;
+}
+
+bool Adafruit_MQTTSN::disconnect() {
+  uint8_t packet[2] = { 2, MQTTSN_DISCONNECT };
+  bool ok = sendPacket(packet, 2) && awaitPacket(MQTTSN_DISCONNECT, 0, MQTTSN_TIMEOUT_MS);
+  state = STATE_DISCONNECTED;
+  return ok;
+}
+
+bool Adafruit_MQTTSN::sleep(uint16_t seconds) {
+  if (state == STATE_DISCONNECTED)
+    return false;
+  uint8_t packet[4] = { 4, MQTTSN_DISCONNECT, (uint8_t)(seconds >> 8), (uint8_t)seconds };
+  for (uint8_t retry=0; retry<MQTTSN_RETRIES; retry++) {
+    if (sendPacket(packet, 4) && awaitPacket(MQTTSN_DISCONNECT, 0, MQTTSN_TIMEOUT_MS)) {
+      state = STATE_ASLEEP;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Adafruit_MQTTSN::wake() {
+  if (state != STATE_ASLEEP)
+    return false;
+
+  // PINGREQ with our client id: the gateway sends whatever it buffered,
+  // then PINGRESP, and we're considered asleep again.
+  uint8_t cidlen = strlen(clientid);
+  if (cidlen > MQTTSN_MAXPACKET - 2)
+    cidlen = MQTTSN_MAXPACKET - 2;
+  for (uint8_t retry=0; retry<MQTTSN_RETRIES; retry++) {
+    // rebuilt each time, the read overwrites buffer
+    buffer[0] = 2 + cidlen;
+    buffer[1] = MQTTSN_PINGREQ;
+    memcpy(buffer + 2, clientid, cidlen);
+    if (sendPacket(buffer, 2 + cidlen) && awaitPacket(MQTTSN_PINGRESP, 0, MQTTSN_TIMEOUT_MS))
+      return true;
+  }
+  // a gateway ignores PINGREQ from a client it has no session for
+  state = STATE_DISCONNECTED;
+  return false;
+}
+
+uint16_t Adafruit_MQTTSN::registerTopic(const char *topicName) {
+  if (state != STATE_ACTIVE)
+    return 0;
+  uint8_t namelen = strlen(topicName);
+  if (namelen > MQTTSN_MAXPACKET - 6)
+    return 0;
+
+  for (uint8_t retry=0; retry<MQTTSN_RETRIES; retry++) {
+    uint16_t msgId = nextMsgId();
+    buffer[0] = 6 + namelen;
+    buffer[1] = MQTTSN_REGISTER;
+    buffer[2] = 0;  // topic id, only set by the gateway
+    buffer[3] = 0;
+    buffer[4] = msgId >> 8;
+    buffer[5] = msgId & 0xFF;
+    memcpy(buffer + 6, topicName, namelen);
+    if (!sendPacket(buffer, 6 + namelen))
+      continue;
+    if (awaitPacket(MQTTSN_REGACK, msgId, MQTTSN_TIMEOUT_MS))
+      return buffer[6] == 0 ? (buffer[2] << 8) | buffer[3] : 0;
+  }
+  return 0;
+}
+
+bool Adafruit_MQTTSN::ping() {
+  uint8_t packet[2] = { 2, MQTTSN_PINGREQ };
+  return sendPacket(packet, 2) && awaitPacket(MQTTSN_PINGRESP, 0, MQTTSN_TIMEOUT_MS);
+}
+
+bool Adafruit_MQTTSN::publish(uint16_t topicId, const uint8_t *payload, uint8_t len,
+                              int8_t qos, uint8_t topicType) {
+  if (len > MQTTSN_MAXPACKET - 7)
+    return false;
+  // QoS 0 and 1 need a connection, -1 never does but only has predefined ids
+  if (qos >= 0 && state != STATE_ACTIVE)
+    return false;
+  if (qos < 0 && topicType != MQTTSN_TOPIC_PREDEFINED)
+    return false;
+
+  uint16_t msgId = (qos > 0) ? nextMsgId() : 0;
+  uint8_t qosbits = ((qos < 0) ? 0x60 : (qos << 5)) | topicType;
+
+  uint8_t *p = buffer;
+  p[0] = 7 + len;
+  p[1] = MQTTSN_PUBLISH;
+  p[2] = qosbits;
+  p[3] = topicId >> 8;
+  p[4] = topicId & 0xFF;
+  p[5] = msgId >> 8;
+  p[6] = msgId & 0xFF;
+  memcpy(p + 7, payload, len);
+
+  if (qos <= 0)
+    return sendPacket(buffer, 7 + len);
+
+  for (uint8_t retry=0; retry<MQTTSN_RETRIES; retry++) {
+    if (retry > 0) {
+      // rebuild with DUP set, buffer was overwritten by the read
+      p[0] = 7 + len;
+      p[1] = MQTTSN_PUBLISH;
+      p[2] = 0x80 | qosbits;
+      p[3] = topicId >> 8;
+      p[4] = topicId & 0xFF;
+      p[5] = msgId >> 8;
+      p[6] = msgId & 0xFF;
+      memcpy(p + 7, payload, len);
+    }
+    if (!sendPacket(buffer, 7 + len))
+      continue;
+    if (awaitPacket(MQTTSN_PUBACK, msgId, MQTTSN_TIMEOUT_MS))
+      return buffer[6] == 0;  // return code
+  }
+  return false;
+}
+
+bool Adafruit_MQTTSN::subscribe(Adafruit_MQTTSN_Subscribe *sub) {
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    if (subscriptions[i] == sub)
+      return true;
+  }
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    if (subscriptions[i] == 0) {
+      subscriptions[i] = sub;
+      // already connected, tell the gateway now
+      if (state == STATE_ACTIVE)
+        return subscribeTopic(sub);
+      return true;
+    }
+  }
+  DEBUG_PRINTLN(F("no more subscription space :("));
+  return false;
+}
+
+bool Adafruit_MQTTSN::subscribeTopic(Adafruit_MQTTSN_Subscribe *sub) {
+  for (uint8_t retry=0; retry<MQTTSN_RETRIES; retry++) {
+    uint16_t msgId = nextMsgId();
+    uint8_t packet[7] = { 7, MQTTSN_SUBSCRIBE,
+                          (uint8_t)(((sub->qos ? 1 : 0) << 5) | MQTTSN_TOPIC_PREDEFINED),
+                          (uint8_t)(msgId >> 8), (uint8_t)msgId,
+                          (uint8_t)(sub->topicId >> 8), (uint8_t)sub->topicId };
+    if (!sendPacket(packet, 7))
+      continue;
+    if (awaitPacket(MQTTSN_SUBACK, msgId, MQTTSN_TIMEOUT_MS))
+      return buffer[7] == 0;
+  }
+  return false;
+}
+
+Adafruit_MQTTSN_Subscribe *Adafruit_MQTTSN::handlePublish(uint8_t *packet, uint8_t len) {
+  if (len < 7)
+    return NULL;
+  uint16_t topicId = (packet[3] << 8) | packet[4];
+  uint16_t msgId = (packet[5] << 8) | packet[6];
+  uint8_t qos = (packet[2] >> 5) & 0x3;
+
+  Adafruit_MQTTSN_Subscribe *sub = NULL;
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    if (subscriptions[i] && subscriptions[i]->topicId == topicId) {
+      sub = subscriptions[i];
+      break;
+    }
+  }
+
+  if (sub) {
+    uint16_t datalen = len - 7;
+    if (datalen > SUBSCRIPTIONDATALEN - 1)
+      datalen = SUBSCRIPTIONDATALEN - 1;  // cut it off
+    memset(sub->lastread, 0, SUBSCRIPTIONDATALEN);
+    memcpy(sub->lastread, packet + 7, datalen);
+    sub->datalen = datalen;
+    sub->pending = true;
+  }
+
+  if (qos == 1) {
+    uint8_t puback[7] = { 7, MQTTSN_PUBACK, (uint8_t)(topicId >> 8), (uint8_t)topicId,
+                          (uint8_t)(msgId >> 8), (uint8_t)msgId,
+                          (uint8_t)(sub ? 0 : 2) };  // 2 = invalid topic id
+    sendPacket(puback, 7);
+  }
+  return sub;
+}
+
+Adafruit_MQTTSN_Subscribe *Adafruit_MQTTSN::readSubscription(int16_t timeout) {
+  // messages that arrived while we were waiting for something else first
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    if (subscriptions[i] && subscriptions[i]->pending) {
+      subscriptions[i]->pending = false;
+      return subscriptions[i];
+    }
+  }
+
+  uint32_t start = millis();
+  while ((int32_t)(millis() - start) <= timeout) {
+    uint8_t len = readPacket(buffer, timeout - (millis() - start));
+    if (!len)
+      return NULL;
+    if (buffer[1] != MQTTSN_PUBLISH)
+      continue;
+    Adafruit_MQTTSN_Subscribe *sub = handlePublish(buffer, len);
+    if (sub) {
+      sub->pending = false;
+      return sub;
+    }
+  }
+  return NULL;
+}
+
+// Adafruit_MQTTSN_Publish Definition //////////////////////////////////////////
+
+Adafruit_MQTTSN_Publish::Adafruit_MQTTSN_Publish(Adafruit_MQTTSN *m, uint16_t id, int8_t q) {
+  mqttsn = m;
+  topicName = 0;
+  topicId = id;
+  registeredIn = 0;
+  qos = q;
+}
+
+Adafruit_MQTTSN_Publish::Adafruit_MQTTSN_Publish(Adafruit_MQTTSN *m, const char *name,
+                                                 int8_t q) {
+  mqttsn = m;
+  topicName = name;
+  topicId = 0;
+  registeredIn = 0;
+  qos = q;
+}
+
+bool Adafruit_MQTTSN_Publish::send(const uint8_t *payload, uint8_t len) {
+  if (!topicName)
+    return mqttsn->publish(topicId, payload, len, qos);
+
+  // the gateway forgets registrations with the session
+  if (topicId == 0 || registeredIn != mqttsn->session()) {
+    topicId = mqttsn->registerTopic(topicName);
+    registeredIn = mqttsn->session();
+    if (topicId == 0)
+      return false;
+  }
+  return mqttsn->publish(topicId, payload, len, qos, MQTTSN_TOPIC_NORMAL);
+}
+
+bool Adafruit_MQTTSN_Publish::publish(const char *s) {
+  return send((const uint8_t *)s, strlen(s));
+}
+
+bool Adafruit_MQTTSN_Publish::publish(double f, uint8_t precision) {
+  char payload[41];
+  snprintf(payload, sizeof(payload), "%.*f", precision, f);
+  return publish(payload);
+}
+
+bool Adafruit_MQTTSN_Publish::publish(int i) {
+  char payload[12];
+  itoa(i, payload, 10);
+  return publish(payload);
+}
+
+bool Adafruit_MQTTSN_Publish::publish(uint32_t i) {
+  char payload[11];
+  ultoa(i, payload, 10);
+  return publish(payload);
+}
+
+bool Adafruit_MQTTSN_Publish::publish(uint8_t *b, uint8_t bLen) {
+  return send(b, bLen);
+}
+
+// Adafruit_MQTTSN_Subscribe Definition ////////////////////////////////////////
+
+Adafruit_MQTTSN_Subscribe::Adafruit_MQTTSN_Subscribe(Adafruit_MQTTSN *m, uint16_t id,
+                                                     uint8_t q) {
+  (void)m;
+  topicId = id;
+  qos = q;
+  datalen = 0;
+  pending = false;
+  memset(lastread, 0, SUBSCRIPTIONDATALEN);
+}
@@ -0,0 +1,166 @@
+// MQTT-SN (MQTT for Sensor Networks, v1.2) client over UDP.
+//
+// Mirrors Adafruit_MQTT / Adafruit_MQTT_Publish / Adafruit_MQTT_Subscribe
+// for nodes that shouldn't hold a TCP session open.  Talks to an MQTT-SN
+// gateway (e.g. the Eclipse Paho MQTT-SN gateway) which bridges to the real
+// broker.  Topics are predefined 16 bit IDs configured on the gateway
+// instead of the long "<user>/feeds/<name>" strings, so a publish is a
+// 7 byte header plus payload.
+//
+// Supported:
+//   - QoS -1: fire-and-forget publish with no connection at all
+//   - QoS 0 and 1 publish and subscribe on predefined topic IDs
+//   - QoS 0 and 1 publish by topic name: the name is REGISTERed once per
+//     session and the gateway's topic id used from then on
+//   - sleeping clients: sleep() tells the gateway to buffer messages,
+//     wake() collects them, so a node can wake, publish and sleep again
+//     without reconnecting
+#ifndef _ADAFRUIT_MQTTSN_H_
+#define _ADAFRUIT_MQTTSN_H_
+
+#include "Adafruit_MQTT.h"
+
+#define MQTTSN_ADVERTISE   0x00
+#define MQTTSN_CONNECT     0x04
+#define MQTTSN_CONNACK     0x05
+#define MQTTSN_REGISTER    0x0A
+#define MQTTSN_REGACK      0x0B
+#define MQTTSN_PUBLISH     0x0C
+#define MQTTSN_PUBACK      0x0D
+#define MQTTSN_SUBSCRIBE   0x12
+#define MQTTSN_SUBACK      0x13
+#define MQTTSN_PINGREQ     0x16
+#define MQTTSN_PINGRESP    0x17
+#define MQTTSN_DISCONNECT  0x18
+
+#define MQTTSN_FLAG_CLEANSESSION 0x04
+#define MQTTSN_TOPIC_NORMAL      0x00
+#define MQTTSN_TOPIC_PREDEFINED  0x01
+
+// QoS -1, publish without connecting
+#define MQTTSN_QOS_M1 -1
+
+#define MQTTSN_PROTOCOL_ID 0x01
+
+// Largest datagram we build or accept.
+#define MQTTSN_MAXPACKET 64
+// How long to wait for a gateway reply, and how often to retry.
+#define MQTTSN_TIMEOUT_MS 1000
+#define MQTTSN_RETRIES    3
+// How long to delay waiting for a datagram in readPacket.
+#define MQTTSN_READINTERVAL_MS 5
+// Keep alive sent in CONNECT, in seconds.
+#define MQTTSN_KEEPALIVE 300
+
+class Adafruit_MQTTSN_Subscribe;  // forward decl
+
+class Adafruit_MQTTSN {
+ public:
+  Adafruit_MQTTSN(UDP *udp, IPAddress gateway, uint16_t port, const char *cid,
+                  uint16_t localPort = 0);
+
+  // Connect to the gateway and subscribe.  Returns 0 on success, -1 if the
+  // gateway didn't answer, or the MQTT-SN return code (1 = congestion,
+  // 2 = invalid topic id, 3 = not supported).
+  int8_t connect();
+  bool disconnect();
+  bool connected() { return state == STATE_ACTIVE; }
+  // Between a successful sleep() and the next connect() or disconnect(), or
+  // a wake() the gateway didn't answer.
+  bool asleep() { return state == STATE_ASLEEP; }
+  // Counts successful connects.  Topic ids from registerTopic() belong to
+  // the session they were registered in.
+  uint16_t session() { return sessionCounter; }
+
+  // Tell the gateway we're going to sleep for up to 'seconds'; it buffers
+  // messages for our subscriptions until wake().
+  bool sleep(uint16_t seconds);
+  // Collect anything buffered while asleep, then go back to sleeping.  Use
+  // readSubscription(0) afterwards to pick up the messages.  If the gateway
+  // never answers it has most likely lost the session (a restart does
+  // that), so the client counts as disconnected and has to connect() again.
+  bool wake();
+
+  // Ask the gateway for a topic id for a topic name.  Returns the id, or 0
+  // if the gateway refused or didn't answer.  Needs a connection.
+  uint16_t registerTopic(const char *topicName);
+
+  // Publish to a topic id, predefined unless topicType is
+  // MQTTSN_TOPIC_NORMAL (an id from registerTopic()).  qos is -1, 0 or 1;
+  // -1 only works with predefined ids.
+  bool publish(uint16_t topicId, const uint8_t *payload, uint8_t len, int8_t qos = 0,
+               uint8_t topicType = MQTTSN_TOPIC_PREDEFINED);
+
+  bool subscribe(Adafruit_MQTTSN_Subscribe *sub);
+
+  // Same contract as Adafruit_MQTT::readSubscription().
+  Adafruit_MQTTSN_Subscribe *readSubscription(int16_t timeout = 0);
+
+  bool ping();
+
+ private:
+  enum { STATE_DISCONNECTED, STATE_ACTIVE, STATE_ASLEEP };
+
+  bool sendPacket(const uint8_t *packet, uint8_t len);
+  uint8_t readPacket(uint8_t *packet, int16_t timeout);
+  // Read until a packet of the given type shows up, handling any PUBLISH
+  // that arrives in the meantime.
+  uint8_t awaitPacket(uint8_t type, uint16_t msgId, int16_t timeout);
+  Adafruit_MQTTSN_Subscribe *handlePublish(uint8_t *packet, uint8_t len);
+  bool subscribeTopic(Adafruit_MQTTSN_Subscribe *sub);
+  uint16_t nextMsgId();
+
+  UDP *udp;
+  IPAddress gateway;
+  uint16_t port;
+  uint16_t localPort;
+  bool udpStarted;
+  const char *clientid;
+  uint8_t state;
+  uint16_t msgIdCounter;
+  uint16_t sessionCounter;
+  uint8_t buffer[MQTTSN_MAXPACKET];
+
+  Adafruit_MQTTSN_Subscribe *subscriptions[MAXSUBSCRIPTIONS];
+};
+
+class Adafruit_MQTTSN_Publish {
+ public:
+  Adafruit_MQTTSN_Publish(Adafruit_MQTTSN *mqttsn, uint16_t topicId, int8_t qos = 0);
+  // By topic name, registered on the first publish of each session.  qos
+  // is 0 or 1.
+  Adafruit_MQTTSN_Publish(Adafruit_MQTTSN *mqttsn, const char *topicName, int8_t qos = 0);
+
+  bool publish(const char *s);
+  bool publish(double f, uint8_t precision=2);
+  bool publish(int i);
+  bool publish(uint32_t i);
+  bool publish(uint8_t *b, uint8_t bLen);
+
+ private:
+  bool send(const uint8_t *payload, uint8_t len);
+
+  Adafruit_MQTTSN *mqttsn;
+  const char *topicName;
+  uint16_t topicId;
+  uint16_t registeredIn;  // session the topic id came from
+  int8_t qos;
+};
+
+class Adafruit_MQTTSN_Subscribe {
+ public:
+  Adafruit_MQTTSN_Subscribe(Adafruit_MQTTSN *mqttsn, uint16_t topicId, uint8_t qos = 0);
+
+  uint16_t topicId;
+  uint8_t qos;
+
+  uint8_t lastread[SUBSCRIPTIONDATALEN];
+  // Number valid bytes in lastread. Limited to SUBSCRIPTIONDATALEN-1 to
+  // ensure nul terminating lastread.
+  uint16_t datalen;
+
+  // A message arrived that readSubscription() hasn't returned yet.
+  bool pending;
+};
+
+#endif
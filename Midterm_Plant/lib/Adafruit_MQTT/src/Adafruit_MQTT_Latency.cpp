@@ -0,0 +1,49 @@
+#include "Adafruit_MQTT_Latency.h"
+
+Adafruit_MQTT_Latency::Adafruit_MQTT_Latency(uint32_t sloMicros) {
+  slo = sloMicros;
+  reset();
+}
+
+void Adafruit_MQTT_Latency::reset() {
+  for (uint8_t i=0; i<MQTT_LATENCY_BUCKETS; i++) {
+    buckets[i] = 0;
+  }
+  count = 0;
+  maxSeen = 0;
+  sloMisses = 0;
+}
+
+void Adafruit_MQTT_Latency::record(uint32_t us) {
+  // bucket is the bit length of the sample
+  uint8_t b = us ? 32 - __builtin_clz(us) : 0;
+  if (b >= MQTT_LATENCY_BUCKETS)
+    b = MQTT_LATENCY_BUCKETS - 1;
+  buckets[b]++;
+  count++;
+  if (us > maxSeen)
+    maxSeen = us;
+  if (slo && us > slo)
+    sloMisses++;
+}
+
+uint32_t Adafruit_MQTT_Latency::percentile(uint8_t p) {
+  if (count == 0)
+    return 0;
+  // rank of the sample we want, rounded up
+  uint32_t rank = ((uint64_t)count * p + 99) / 100;
+  if (rank == 0)
+    rank = 1;
+  uint32_t seen = 0;
+  for (uint8_t b=0; b<MQTT_LATENCY_BUCKETS; b++) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      // the top bucket is open ended, the worst sample is the best answer
+      if (b == MQTT_LATENCY_BUCKETS - 1)
+        return maxSeen;
+      uint32_t top = b ? (1UL << b) - 1 : 0;
+      return top < maxSeen ? top : maxSeen;
+    }
+  }
+  return maxSeen;
+}
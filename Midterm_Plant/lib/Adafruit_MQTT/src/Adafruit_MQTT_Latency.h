@@ -0,0 +1,45 @@
+// Latency histogram.
+//
+// Samples in microseconds go into power-of-two buckets (bucket n holds
+// 2^(n-1) .. 2^n - 1 us), so recording is a couple of instructions and the
+// whole thing is about 100 bytes.  Percentiles come back as the upper
+// edge of their bucket, so they're accurate to within a factor of two,
+// which is plenty to hold an SLO against.  Samples over the SLO are also
+// counted exactly.
+#ifndef _ADAFRUIT_MQTT_LATENCY_H_
+#define _ADAFRUIT_MQTT_LATENCY_H_
+
+#if defined(SPARK)
+  #include "application.h"
+#elif defined(ARDUINO)
+  #include "Arduino.h"
+#endif
+
+// Closed buckets cover 0 us up to 2^21 - 1 us (~2.1 s); the last bucket
+// is open ended and takes everything from ~2.1 s up.
+#define MQTT_LATENCY_BUCKETS 23
+
+class Adafruit_MQTT_Latency {
+ public:
+  // sloMicros of 0 means no SLO.
+  Adafruit_MQTT_Latency(uint32_t sloMicros = 0);
+
+  void record(uint32_t micros);
+  void reset();
+
+  // p in percent, 50 for the median.  Returns 0 with no samples.
+  uint32_t percentile(uint8_t p);
+  uint32_t samples() { return count; }
+  uint32_t worst() { return maxSeen; }
+  // Samples that took longer than the SLO.
+  uint32_t overSlo() { return sloMisses; }
+
+ private:
+  uint32_t buckets[MQTT_LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxSeen;
+  uint32_t slo;
+  uint32_t sloMisses;
+};
+
+#endif
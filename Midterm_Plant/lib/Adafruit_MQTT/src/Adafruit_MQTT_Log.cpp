@@ -0,0 +1,77 @@
+#include "Adafruit_MQTT_Log.h"
+
+Adafruit_MQTT_Log mqttLog;
+
+Adafruit_MQTT_Log::Adafruit_MQTT_Log() :
+  head(0), tail(0), droppedCount(0), droppedReported(0) {
+}
+
+bool Adafruit_MQTT_Log::push(uint8_t id, uint8_t argc, int32_t a, int32_t b, int32_t c) {
+  uint16_t h = head.load(std::memory_order_relaxed);
+  uint16_t next = (h + 1) & (MQTT_LOG_EVENTS - 1);
+  if (next == tail.load(std::memory_order_acquire)) {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  Adafruit_MQTT_LogEvent &ev = events[h];
+  ev.ms = millis();
+  ev.id = id;
+  ev.argc = argc;
+  ev.args[0] = a;
+  ev.args[1] = b;
+  ev.args[2] = c;
+  // publish the event only once it's complete
+  head.store(next, std::memory_order_release);
+  return true;
+}
+
+uint8_t Adafruit_MQTT_Log::encode(const Adafruit_MQTT_LogEvent &ev, uint8_t *record) {
+  uint8_t *p = record;
+  *p++ = MQTT_LOG_SYNC;
+  *p++ = ev.id;
+  *p++ = ev.argc;
+  for (uint8_t i=0; i<4; i++)
+    *p++ = ev.ms >> (8 * i);
+  for (uint8_t a=0; a<ev.argc; a++)
+    for (uint8_t i=0; i<4; i++)
+      *p++ = (uint32_t)ev.args[a] >> (8 * i);
+  uint8_t sum = 0;
+  for (uint8_t *q = record + 1; q < p; q++)
+    sum += *q;
+  *p++ = sum;
+  return p - record;
+}
+
+uint16_t Adafruit_MQTT_Log::drain(Print &out, int room) {
+  uint8_t record[MQTT_LOG_RECORDLEN];
+  uint16_t written = 0;
+
+  uint32_t lost = dropped() - droppedReported;
+  if (lost) {
+    Adafruit_MQTT_LogEvent ev = { (uint32_t)millis(), MQTT_LOG_EVENTS_DROPPED, 1, { (int32_t)lost } };
+    uint8_t len = encode(ev, record);
+    if (len > room)
+      return 0;
+    out.write(record, len);
+    room -= len;
+    droppedReported += lost;
+  }
+
+  uint16_t t = tail.load(std::memory_order_relaxed);
+  while (t != head.load(std::memory_order_acquire)) {
+    uint8_t len = encode(events[t], record);
+    if (len > room)
+      break;
+    out.write(record, len);
+    room -= len;
+    written++;
+    t = (t + 1) & (MQTT_LOG_EVENTS - 1);
+    tail.store(t, std::memory_order_release);
+  }
+  return written;
+}
+
+uint16_t Adafruit_MQTT_Log::pending() {
+  return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) &
+         (MQTT_LOG_EVENTS - 1);
+}
@@ -0,0 +1,102 @@
+// Deferred event log.
+//
+// Logging an event stores a format id, a timestamp and up to three integer
+// arguments in a ring buffer.  Nothing is formatted on the device at all:
+// drain() writes the events out later as compact binary records, when the
+// loop has nothing better to do, and only as many as the output can take
+// without blocking.  The host turns them into text, see
+// Midterm_Plant/host/mqtt-log-decode.
+//
+// The ring has one producer (the application thread) and one consumer
+// (whoever calls drain()), and needs no locks.  Don't log from interrupts.
+// When the ring is full new events are dropped and counted; drain() reports
+// how many were lost as an MQTT_LOG_EVENTS_DROPPED event.
+//
+//   ERROR_LOG(MQTT_LOG_THROTTLED, wait);          // library events
+//   mqttLog.log(MQTT_LOG_USER + 1, moisture);      // sketch events start at
+//   ...                                            // MQTT_LOG_USER
+//   mqttLog.drain(Serial, Serial.availableForWrite());
+//
+// A record on the wire, multi-byte fields little endian:
+//   MQTT_LOG_SYNC, id, argc, ms (4 bytes), argc args (4 bytes each),
+//   checksum (sum of everything after the sync byte, low 8 bits)
+// The sync byte and checksum let the decoder skip anything else written to
+// the same port.
+#ifndef _ADAFRUIT_MQTT_LOG_H_
+#define _ADAFRUIT_MQTT_LOG_H_
+
+#include <atomic>
+#if defined(SPARK)
+  #include "application.h"
+#elif defined(ARDUINO)
+  #include "Arduino.h"
+#endif
+
+// Number of events held, must be a power of two.
+#define MQTT_LOG_EVENTS  32
+#define MQTT_LOG_MAXARGS 3
+
+#define MQTT_LOG_SYNC 0xA5
+// Longest record: sync, id, argc, ms, args, checksum.
+#define MQTT_LOG_RECORDLEN (3 + 4 + 4 * MQTT_LOG_MAXARGS + 1)
+
+// Library event ids.  Ids from MQTT_LOG_USER up are the application's.
+enum {
+  MQTT_LOG_DROPPED_PACKET,   // packet type
+  MQTT_LOG_THROTTLED,        // pause in ms
+  MQTT_LOG_CONNECT_FAILED,   // broker (0 local, 1 cloud), error code
+  MQTT_LOG_DEAD_LINK,        // broker, smoothed rtt, rtt variance
+  MQTT_LOG_EVENTS_DROPPED,   // events lost to a full ring
+  MQTT_LOG_LIBRARY_EVENTS,
+
+  MQTT_LOG_USER = 32
+};
+
+// Text for the library events, in id order, for the host decoder.  Only
+// ever expanded on the host; arguments are longs.
+#define MQTT_LOG_LIBRARY_FORMATS \
+  "MQTT: dropped a packet, type %ld", \
+  "MQTT: throttled by broker, pausing publishes %ld ms", \
+  "MQTT: broker %ld connect failed, error %ld", \
+  "MQTT: broker %ld dead link (rtt %ld ms, var %ld ms), disconnecting", \
+  "log: %ld events dropped"
+
+struct Adafruit_MQTT_LogEvent {
+  uint32_t ms;
+  uint8_t id;
+  uint8_t argc;
+  int32_t args[MQTT_LOG_MAXARGS];
+};
+
+class Adafruit_MQTT_Log {
+ public:
+  Adafruit_MQTT_Log();
+
+  // Record an event.  Returns false if the ring was full.
+  bool log(uint8_t id) { return push(id, 0, 0, 0, 0); }
+  bool log(uint8_t id, int32_t a) { return push(id, 1, a, 0, 0); }
+  bool log(uint8_t id, int32_t a, int32_t b) { return push(id, 2, a, b, 0); }
+  bool log(uint8_t id, int32_t a, int32_t b, int32_t c) { return push(id, 3, a, b, c); }
+
+  // Write queued events to out as records, as many as fit in room bytes.
+  // Events that don't fit stay queued.  Returns the number written.
+  uint16_t drain(Print &out, int room);
+
+  uint16_t pending();
+  // Events lost because the ring was full.
+  uint32_t dropped() { return droppedCount.load(std::memory_order_relaxed); }
+
+ private:
+  bool push(uint8_t id, uint8_t argc, int32_t a, int32_t b, int32_t c);
+  static uint8_t encode(const Adafruit_MQTT_LogEvent &ev, uint8_t *record);
+
+  Adafruit_MQTT_LogEvent events[MQTT_LOG_EVENTS];
+  std::atomic<uint16_t> head;  // written by the producer
+  std::atomic<uint16_t> tail;  // written by the consumer
+  std::atomic<uint32_t> droppedCount;
+  uint32_t droppedReported;
+};
+
+extern Adafruit_MQTT_Log mqttLog;
+
+#endif
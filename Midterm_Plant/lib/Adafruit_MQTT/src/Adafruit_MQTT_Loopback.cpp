@@ -0,0 +1,248 @@
+#include "Adafruit_MQTT_Loopback.h"
+
+Adafruit_MQTT_Loopback::Adafruit_MQTT_Loopback(const char *cid, const char *user,
+                                               const char *pass) :
+  Adafruit_MQTT("loopback", 0, cid, user, pass) {
+  init();
+}
+
+Adafruit_MQTT_Loopback::Adafruit_MQTT_Loopback(const char *user, const char *pass) :
+  Adafruit_MQTT("loopback", 0, user, pass) {
+  init();
+}
+
+void Adafruit_MQTT_Loopback::init() {
+  linkUp = false;
+  latency = 0;
+  loss = 0;
+  disconnectEvery = 0;
+  packetsThisLink = 0;
+  rxPos = rxLen = 0;
+  rxReadyAt = 0;
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    brokerSubs[i][0] = 0;
+  }
+  resetCounters();
+}
+
+void Adafruit_MQTT_Loopback::resetCounters() {
+  bytesSent = 0;
+  bytesReceived = 0;
+  packetsSent = 0;
+  packetsDropped = 0;
+  disconnects = 0;
+}
+
+bool Adafruit_MQTT_Loopback::connected() {
+  return linkUp;
+}
+
+bool Adafruit_MQTT_Loopback::connectServer() {
+  linkUp = true;
+  packetsThisLink = 0;
+  rxPos = rxLen = 0;
+  // a new session on the broker side, clean session is always set
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    brokerSubs[i][0] = 0;
+  }
+  return true;
+}
+
+bool Adafruit_MQTT_Loopback::disconnectServer() {
+  linkUp = false;
+  rxPos = rxLen = 0;
+  return true;
+}
+
+void Adafruit_MQTT_Loopback::dropLink() {
+  DEBUG_PRINTLN(F("Loopback: dropping link"));
+  linkUp = false;
+  rxPos = rxLen = 0;
+  disconnects++;
+}
+
+bool Adafruit_MQTT_Loopback::sendPacket(uint8_t *buffer, uint16_t len) {
+  if (!linkUp) {
+    DEBUG_PRINTLN(F("Connection failed!"));
+    return false;
+  }
+
+  bytesSent += len;
+  packetsSent++;
+
+  if (disconnectEvery && ++packetsThisLink > disconnectEvery) {
+    dropLink();
+    return false;
+  }
+
+  // lost on the way; the client thinks it went out fine
+  if (loss && (uint8_t)random(100) < loss) {
+    packetsDropped++;
+    return true;
+  }
+
+  brokerHandle(buffer, len);
+  return true;
+}
+
+uint16_t Adafruit_MQTT_Loopback::readPacket(uint8_t *buffer, uint16_t maxlen,
+                                            int16_t timeout) {
+  uint16_t len = 0;
+  uint32_t start = millis();
+
+  while (linkUp && len < maxlen) {
+    if (rxPos != rxLen && (int32_t)(millis() - rxReadyAt) >= 0) {
+      uint16_t n = min((uint16_t)(rxLen - rxPos), (uint16_t)(maxlen - len));
+      memcpy(buffer + len, rx + rxPos, n);
+      rxPos += n;
+      len += n;
+      bytesReceived += n;
+      if (rxPos == rxLen)
+        rxPos = rxLen = 0;
+      continue;
+    }
+
+    rxIdle();
+    // reply still "in flight", or lost and never coming; either way wait
+    // out the timeout like a socket would, so loss costs what it costs
+    // on a real link
+    if (timeout <= 0 || (millis() - start) >= (uint32_t)timeout)
+      break;
+    delay(1);
+  }
+  return len;
+}
+
+int Adafruit_MQTT_Loopback::bytesAvailable() {
+  if (!linkUp || rxPos == rxLen || (int32_t)(millis() - rxReadyAt) < 0)
+    return 0;
+  return rxLen - rxPos;
+}
+
+void Adafruit_MQTT_Loopback::queueReply(const uint8_t *data, uint16_t len) {
+  if (rxLen + len > LOOPBACK_BUFFERSIZE) {
+    DEBUG_PRINTLN(F("Loopback: reply buffer full"));
+    return;
+  }
+  if (rxPos == rxLen)
+    rxReadyAt = millis() + latency;
+  memcpy(rx + rxLen, data, len);
+  rxLen += len;
+}
+
+// Index of the subscription for topic, -1 if there isn't one.
+int8_t Adafruit_MQTT_Loopback::brokerSlot(const char *topic, uint16_t topiclen) {
+  for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+    if (brokerSubs[i][0] && strlen(brokerSubs[i]) == topiclen &&
+        strncasecmp(brokerSubs[i], topic, topiclen) == 0)
+      return i;
+  }
+  return -1;
+}
+
+bool Adafruit_MQTT_Loopback::brokerSubscribed(const char *topic, uint16_t topiclen) {
+  return brokerSlot(topic, topiclen) >= 0;
+}
+
+// Broker stand-in.  Only handles what Adafruit_MQTT actually sends.
+void Adafruit_MQTT_Loopback::brokerHandle(uint8_t *pkt, uint16_t len) {
+  uint8_t type = pkt[0] >> 4;
+
+  // skip the remaining length to find the variable header
+  uint16_t pos = 1;
+  while (pos < len && (pkt[pos] & 0x80)) pos++;
+  pos++;
+
+  switch (type) {
+    case MQTT_CTRL_CONNECT: {
+      uint8_t connack[4] = { MQTT_CTRL_CONNECTACK << 4, 2, 0, 0 };
+      queueReply(connack, 4);
+      break;
+    }
+
+    case MQTT_CTRL_SUBSCRIBE: {
+      uint16_t topiclen = (pkt[pos+2] << 8) | pkt[pos+3];
+      const char *topic = (const char *)pkt + pos + 4;
+      uint8_t qos = pkt[pos+4+topiclen];
+      uint8_t rc = 0x80;  // failure
+      if (topiclen < LOOPBACK_TOPICLEN) {
+        // a resubscribe keeps its slot, a new topic takes a free one
+        int8_t slot = brokerSlot(topic, topiclen);
+        for (uint8_t i=0; slot < 0 && i<MAXSUBSCRIPTIONS; i++) {
+          if (brokerSubs[i][0] == 0)
+            slot = i;
+        }
+        if (slot >= 0) {
+          memcpy(brokerSubs[slot], topic, topiclen);
+          brokerSubs[slot][topiclen] = 0;
+          rc = qos > 1 ? 1 : qos;
+        }
+      }
+      uint8_t suback[5] = { MQTT_CTRL_SUBACK << 4, 3, pkt[pos], pkt[pos+1], rc };
+      queueReply(suback, 5);
+      break;
+    }
+
+    case MQTT_CTRL_UNSUBSCRIBE: {
+      uint16_t topiclen = (pkt[pos+2] << 8) | pkt[pos+3];
+      const char *topic = (const char *)pkt + pos + 4;
+      for (uint8_t i=0; i<MAXSUBSCRIPTIONS; i++) {
+        if (strlen(brokerSubs[i]) == topiclen &&
+            strncasecmp(brokerSubs[i], topic, topiclen) == 0)
+          brokerSubs[i][0] = 0;
+      }
+      uint8_t unsuback[4] = { MQTT_CTRL_UNSUBACK << 4, 2, pkt[pos], pkt[pos+1] };
+      queueReply(unsuback, 4);
+      break;
+    }
+
+    case MQTT_CTRL_PUBLISH: {
+      uint8_t qos = (pkt[0] >> 1) & 0x3;
+      uint16_t topiclen = (pkt[pos] << 8) | pkt[pos+1];
+      const char *topic = (const char *)pkt + pos + 2;
+      uint16_t payloadpos = pos + 2 + topiclen + (qos ? 2 : 0);
+
+      if (qos > 0) {
+        uint8_t puback[4] = { MQTT_CTRL_PUBACK << 4, 2,
+                              pkt[pos+2+topiclen], pkt[pos+3+topiclen] };
+        queueReply(puback, 4);
+      }
+
+      // deliver to ourselves at QoS 0, if it fits the reply buffer
+      uint16_t payloadlen = len - payloadpos;
+      uint16_t remaining = 2 + topiclen + payloadlen;
+      uint8_t hdr[4] = { MQTT_CTRL_PUBLISH << 4 };
+      uint8_t hdrlen = 1;
+      uint16_t r = remaining;
+      do {
+        hdr[hdrlen] = r % 128;
+        r /= 128;
+        if (r)
+          hdr[hdrlen] |= 0x80;
+        hdrlen++;
+      } while (r);
+      if (brokerSubscribed(topic, topiclen) &&
+          rxLen + hdrlen + remaining <= LOOPBACK_BUFFERSIZE) {
+        queueReply(hdr, hdrlen);
+        queueReply(pkt + pos, 2 + topiclen);
+        queueReply(pkt + payloadpos, payloadlen);
+      }
+      break;
+    }
+
+    case MQTT_CTRL_PINGREQ: {
+      uint8_t pingresp[2] = { MQTT_CTRL_PINGRESP << 4, 0 };
+      queueReply(pingresp, 2);
+      break;
+    }
+
+    case MQTT_CTRL_DISCONNECT:
+      linkUp = false;
+      rxPos = rxLen = 0;
+      break;
+
+    default:
+      // PUBACK for inbound QoS 1 etc, nothing to answer
+      break;
+  }
+}
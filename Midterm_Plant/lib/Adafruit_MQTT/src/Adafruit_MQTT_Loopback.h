@@ -0,0 +1,72 @@
+// In-memory MQTT transport with a minimal MQTT 3.1.1 broker stand-in.
+//
+// Nothing goes over the network: every packet the client sends is handled
+// by a tiny broker living inside this object, and its replies are queued
+// for readPacket().  It answers CONNECT, SUBSCRIBE, UNSUBSCRIBE, PUBLISH
+// (QoS 0 and 1), PINGREQ and DISCONNECT, and echoes publishes back to the
+// client when the topic matches one of its subscriptions.  This is enough
+// to benchmark the protocol code in Adafruit_MQTT on its own, and faults
+// (reply latency, dropped packets, dropped links) can be injected to see
+// how the client copes.
+#ifndef _ADAFRUIT_MQTT_LOOPBACK_H_
+#define _ADAFRUIT_MQTT_LOOPBACK_H_
+
+#include "Adafruit_MQTT.h"
+
+// Bytes of broker replies that can be queued for the client.
+#define LOOPBACK_BUFFERSIZE 512
+// Longest topic the broker stand-in will remember a subscription for.
+#define LOOPBACK_TOPICLEN   64
+
+class Adafruit_MQTT_Loopback : public Adafruit_MQTT {
+ public:
+  Adafruit_MQTT_Loopback(const char *cid, const char *user, const char *pass);
+  Adafruit_MQTT_Loopback(const char *user = "", const char *pass = "");
+
+  bool connected();
+
+  // Fault injection.  Latency delays every broker reply by ms milliseconds,
+  // loss drops that percentage of client packets before the broker sees
+  // them, and disconnectEvery drops the link after that many client
+  // packets (0 = never).
+  void setLatency(uint16_t ms) { latency = ms; }
+  void setLoss(uint8_t percent) { loss = percent; }
+  void setDisconnectEvery(uint16_t packets) { disconnectEvery = packets; }
+
+  // Traffic counters, from the client's point of view.
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t packetsSent;
+  uint32_t packetsDropped;
+  uint32_t disconnects;
+  void resetCounters();
+
+ protected:
+  bool connectServer();
+  bool disconnectServer();
+  bool sendPacket(uint8_t *buffer, uint16_t len);
+  uint16_t readPacket(uint8_t *buffer, uint16_t maxlen, int16_t timeout);
+  int bytesAvailable();
+
+ private:
+  void init();
+  void dropLink();
+  void brokerHandle(uint8_t *pkt, uint16_t len);
+  void queueReply(const uint8_t *data, uint16_t len);
+  int8_t brokerSlot(const char *topic, uint16_t topiclen);
+  bool brokerSubscribed(const char *topic, uint16_t topiclen);
+
+  bool linkUp;
+  uint16_t latency;
+  uint8_t loss;
+  uint16_t disconnectEvery;
+  uint16_t packetsThisLink;
+
+  uint8_t rx[LOOPBACK_BUFFERSIZE];  // broker -> client
+  uint16_t rxPos, rxLen;
+  uint32_t rxReadyAt;
+
+  char brokerSubs[MAXSUBSCRIPTIONS][LOOPBACK_TOPICLEN];
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "Adafruit_MQTT_PublishPolicy.h"
+
+Adafruit_MQTT_PublishPolicy::Adafruit_MQTT_PublishPolicy(Adafruit_MQTT_Publish *f,
+                                                         uint32_t minMs,
+                                                         uint32_t maxMs,
+                                                         uint8_t prec) {
+  feed = f;
+  minInterval = minMs;
+  maxInterval = maxMs;
+  precision = prec;
+
+  deadband = 0;
+  relativeDeadband = false;
+  rateTrigger = 0;
+
+  havePublished = false;
+  forced = false;
+  lastPublished = 0;
+  lastPublishMs = 0;
+
+  haveSample = false;
+  lastSample = 0;
+  lastSampleMs = 0;
+
+  published = 0;
+  suppressed = 0;
+}
+
+void Adafruit_MQTT_PublishPolicy::setDeadband(double band, bool relative) {
+  deadband = fabs(band);
+  relativeDeadband = relative;
+}
+
+void Adafruit_MQTT_PublishPolicy::setRateTrigger(double perSecond) {
+  rateTrigger = fabs(perSecond);
+}
+
+void Adafruit_MQTT_PublishPolicy::force() {
+  forced = true;
+}
+
+bool Adafruit_MQTT_PublishPolicy::shouldPublish(double value, uint32_t now) {
+  if (!havePublished)
+    return true;
+
+  uint32_t elapsed = now - lastPublishMs;
+  if (elapsed < minInterval)
+    return false;
+
+  if (forced)
+    return true;
+  if (maxInterval > 0 && elapsed >= maxInterval)
+    return true;
+
+  // deadband around the last value that actually went out
+  double band = deadband;
+  if (relativeDeadband)
+    band *= fabs(lastPublished);
+  if (fabs(value - lastPublished) > band)
+    return true;
+
+  // rate of change between this sample and the previous one, so a sharp
+  // drop gets reported even while it's still inside the deadband
+  if (rateTrigger > 0 && haveSample && now != lastSampleMs) {
+    double rate = fabs(value - lastSample) * 1000.0 / (now - lastSampleMs);
+    if (rate >= rateTrigger)
+      return true;
+  }
+
+  return false;
+}
+
+void Adafruit_MQTT_PublishPolicy::accept(double value, uint32_t now) {
+  havePublished = true;
+  forced = false;
+  lastPublished = value;
+  lastPublishMs = now;
+  published++;
+}
+
+bool Adafruit_MQTT_PublishPolicy::update(double value) {
+  uint32_t now = millis();
+  bool send = shouldPublish(value, now);
+
+  // only remember the sample once it's been used for the rate check
+  haveSample = true;
+  lastSample = value;
+  lastSampleMs = now;
+
+  if (!send) {
+    suppressed++;
+    return false;
+  }
+  // on failure leave the last published value alone so the next sample retries
+  if (!feed->publish(value, precision))
+    return false;
+  accept(value, now);
+  return true;
+}
+
+bool Adafruit_MQTT_PublishPolicy::update(int value) {
+  uint32_t now = millis();
+  bool send = shouldPublish(value, now);
+
+  haveSample = true;
+  lastSample = value;
+  lastSampleMs = now;
+
+  if (!send) {
+    suppressed++;
+    return false;
+  }
+  if (!feed->publish(value))
+    return false;
+  accept(value, now);
+  return true;
+}
@@ -0,0 +1,69 @@
+// Per-feed publish policy for Adafruit_MQTT_Publish.
+//
+// Wraps a publisher and decides, on every new sample, whether the value is
+// worth sending.  A sample is published when any of these is true:
+//   - nothing has been published yet (or force() was called)
+//   - the value moved outside the deadband around the last published value
+//   - the value is changing faster than the rate-of-change trigger
+//   - maxInterval has passed since the last publish (heartbeat)
+// and minInterval has passed since the last publish.  Samples that don't
+// qualify are counted as suppressed and dropped.
+#ifndef _ADAFRUIT_MQTT_PUBLISHPOLICY_H_
+#define _ADAFRUIT_MQTT_PUBLISHPOLICY_H_
+
+#include "Adafruit_MQTT.h"
+
+class Adafruit_MQTT_PublishPolicy {
+ public:
+  // minInterval/maxInterval are in milliseconds.  A maxInterval of 0 disables
+  // the heartbeat, a minInterval of 0 lets every qualifying sample through.
+  Adafruit_MQTT_PublishPolicy(Adafruit_MQTT_Publish *feed,
+                              uint32_t minInterval, uint32_t maxInterval,
+                              uint8_t precision = 2);
+
+  // Deadband around the last published value.  If relative is true, band is
+  // a fraction of the last published value (0.05 = 5%).  A band of 0 means
+  // any change at all is published.
+  void setDeadband(double band, bool relative = false);
+
+  // Publish immediately when the value changes by more than perSecond units
+  // per second between two consecutive samples.  0 disables the trigger.
+  void setRateTrigger(double perSecond);
+
+  // Feed a new sample.  Returns true if it was published.
+  bool update(double value);
+  bool update(int value);
+
+  // Publish the next sample regardless of deadband and rate triggers.
+  void force();
+
+  uint32_t publishedCount() { return published; }
+  uint32_t suppressedCount() { return suppressed; }
+
+ private:
+  bool shouldPublish(double value, uint32_t now);
+  void accept(double value, uint32_t now);
+
+  Adafruit_MQTT_Publish *feed;
+  uint32_t minInterval;
+  uint32_t maxInterval;
+  uint8_t precision;
+
+  double deadband;
+  bool relativeDeadband;
+  double rateTrigger;
+
+  bool havePublished;
+  bool forced;
+  double lastPublished;
+  uint32_t lastPublishMs;
+
+  bool haveSample;
+  double lastSample;
+  uint32_t lastSampleMs;
+
+  uint32_t published;
+  uint32_t suppressed;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "Adafruit_MQTT_Router.h"
+
+Adafruit_MQTT_Router::Adafruit_MQTT_Router(Adafruit_MQTT *local, Adafruit_MQTT *cloud,
+                                           uint8_t defRoute) {
+  links[0].mqtt = local;
+  links[1].mqtt = cloud;
+  for (uint8_t i=0; i<2; i++) {
+    links[i].up = false;
+    links[i].backoff = MQTT_BACKOFF_MIN_MS;
+    links[i].nextAttempt = 0;
+    links[i].lastPing = 0;
+    links[i].connects = 0;
+    links[i].failures = 0;
+  }
+  ruleCount = 0;
+  defaultRoute = defRoute;
+  publishesUnrouted = 0;
+}
+
+bool Adafruit_MQTT_Router::addRule(const char *prefix, uint8_t route) {
+  if (ruleCount >= MQTT_ROUTER_MAXRULES)
+    return false;
+  rules[ruleCount].prefix = prefix;
+  rules[ruleCount].len = strlen(prefix);
+  rules[ruleCount].route = route;
+  ruleCount++;
+  return true;
+}
+
+uint8_t Adafruit_MQTT_Router::routeFor(const char *topic) {
+  uint8_t route = defaultRoute;
+  int16_t best = -1;
+  for (uint8_t i=0; i<ruleCount; i++) {
+    if (rules[i].len > best && strncmp(topic, rules[i].prefix, rules[i].len) == 0) {
+      best = rules[i].len;
+      route = rules[i].route;
+    }
+  }
+  return route;
+}
+
+bool Adafruit_MQTT_Router::publish(const char *topic, const char *payload,
+                                   uint8_t qos, uint8_t priority) {
+  return publish(topic, (uint8_t *)payload, strlen(payload), qos, priority);
+}
+
+bool Adafruit_MQTT_Router::publish(const char *topic, uint8_t *payload, uint16_t bLen,
+                                   uint8_t qos, uint8_t priority) {
+  Adafruit_MQTT_PublishHeader header;
+  header.set(topic, qos);
+  return publish(header, payload, bLen, priority);
+}
+
+bool Adafruit_MQTT_Router::publish(const Adafruit_MQTT_PublishHeader &header, uint8_t *payload,
+                                   uint16_t bLen, uint8_t priority) {
+  uint8_t route = routeFor(header.topic);
+  bool sent = false;
+  for (uint8_t i=0; i<2; i++) {
+    if (!(route & (1 << i)) || !links[i].mqtt || !links[i].mqtt->connected())
+      continue;
+    if (links[i].mqtt->publish(header, payload, bLen, priority))
+      sent = true;
+  }
+  if (!sent)
+    publishesUnrouted++;
+  return sent;
+}
+
+bool Adafruit_MQTT_Router::subscribe(Adafruit_MQTT_Subscribe *sub) {
+  uint8_t route = routeFor(sub->topic);
+  bool ok = true;
+  for (uint8_t i=0; i<2; i++) {
+    if ((route & (1 << i)) && links[i].mqtt)
+      ok = links[i].mqtt->subscribe(sub) && ok;
+  }
+  return ok;
+}
+
+Adafruit_MQTT_Subscribe *Adafruit_MQTT_Router::readSubscription(int16_t timeout) {
+  Link &local = links[0];
+  Link &cloud = links[1];
+
+  if (local.up) {
+    // don't sit on the local socket if the cloud one is there to wait on
+    Adafruit_MQTT_Subscribe *sub = local.mqtt->readSubscription(cloud.up ? 0 : timeout);
+    if (sub)
+      return sub;
+  }
+  if (cloud.up)
+    return cloud.mqtt->readSubscription(timeout);
+  return NULL;
+}
+
+void Adafruit_MQTT_Router::maintain() {
+  for (uint8_t i=0; i<2; i++) {
+    if (links[i].mqtt)
+      maintainLink(links[i]);
+  }
+}
+
+void Adafruit_MQTT_Router::maintainLink(Link &link) {
+  uint32_t now = millis();
+
+  if (link.mqtt->connected()) {
+    link.up = true;
+    if (now - link.lastPing > MQTT_ROUTER_PING_MS) {
+      link.lastPing = now;
+      if (!link.mqtt->ping(MQTT_DEAD_LINK_TIMEOUTS) && link.mqtt->deadLink()) {
+        ERROR_LOG(MQTT_LOG_DEAD_LINK, &link - links, link.mqtt->rttSmoothedMs(),
+                  link.mqtt->rttVarianceMs());
+        link.mqtt->disconnect();
+        link.up = false;
+        link.nextAttempt = millis();
+      }
+    }
+    return;
+  }
+
+  if (link.up) {
+    // just lost it, try once straight away before backing off
+    link.up = false;
+    link.nextAttempt = now;
+  }
+  if ((int32_t)(now - link.nextAttempt) < 0)
+    return;
+
+  int8_t ret = link.mqtt->connect();
+  now = millis();
+  if (ret == 0) {
+    link.up = true;
+    link.connects++;
+    link.backoff = MQTT_BACKOFF_MIN_MS;
+    link.lastPing = now;
+    return;
+  }
+
+  ERROR_LOG(MQTT_LOG_CONNECT_FAILED, &link - links, ret);
+  link.mqtt->disconnect();
+  link.failures++;
+  // a little jitter so both links don't retry in lockstep
+  link.nextAttempt = now + link.backoff + random(link.backoff / 4 + 1);
+  link.backoff *= 2;
+  if (link.backoff > MQTT_BACKOFF_MAX_MS)
+    link.backoff = MQTT_BACKOFF_MAX_MS;
+}
+
+void Adafruit_MQTT_Router::serviceQueue(uint16_t budget) {
+  for (uint8_t i=0; i<2; i++) {
+    if (links[i].up)
+      links[i].mqtt->serviceQueue(budget);
+  }
+}
+
+Adafruit_MQTT_Router::Link *Adafruit_MQTT_Router::linkFor(uint8_t route) {
+  return &links[route == MQTT_ROUTE_LOCAL ? 0 : 1];
+}
+
+bool Adafruit_MQTT_Router::connected(uint8_t route) {
+  Link *link = linkFor(route);
+  return link->mqtt && link->mqtt->connected();
+}
+
+uint32_t Adafruit_MQTT_Router::connects(uint8_t route) {
+  return linkFor(route)->connects;
+}
+
+uint32_t Adafruit_MQTT_Router::connectFailures(uint8_t route) {
+  return linkFor(route)->failures;
+}
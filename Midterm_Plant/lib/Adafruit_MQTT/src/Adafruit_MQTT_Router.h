@@ -0,0 +1,107 @@
+// Two-broker routing for Adafruit_MQTT.
+//
+// Keeps a local (edge) broker and a cloud broker connected side by side and
+// sends each topic to one or both of them according to prefix rules.  Control
+// traffic can then stay on the LAN, with no round trip through the cloud,
+// while telemetry still reaches the cloud for history.
+//
+// Each broker reconnects on its own, with exponential backoff, so local
+// control keeps working while the internet is down.  A connect attempt still
+// blocks for up to the TCP connect timeout; the backoff keeps those attempts
+// rare while a broker is unreachable.
+//
+//   Adafruit_MQTT_Router router(&edge, &cloud);
+//   router.addRule(AIO_USERNAME "/feeds/", MQTT_ROUTE_BOTH);
+//   Adafruit_MQTT_Publish temp(&router, AIO_USERNAME "/feeds/planttemp");
+//   ...
+//   router.maintain();   // once per loop
+#ifndef _ADAFRUIT_MQTT_ROUTER_H_
+#define _ADAFRUIT_MQTT_ROUTER_H_
+
+#include "Adafruit_MQTT.h"
+
+// Route bits, a topic can go to either broker or both.
+#define MQTT_ROUTE_NONE  0x00
+#define MQTT_ROUTE_LOCAL 0x01
+#define MQTT_ROUTE_CLOUD 0x02
+#define MQTT_ROUTE_BOTH  (MQTT_ROUTE_LOCAL | MQTT_ROUTE_CLOUD)
+
+#define MQTT_ROUTER_MAXRULES 8
+
+// Reconnect backoff, doubled after every failed attempt.
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+// How often maintain() pings each connected broker.
+#define MQTT_ROUTER_PING_MS 60000
+
+class Adafruit_MQTT_Router {
+ public:
+  // Topics that don't match any rule go to defaultRoute.  Either broker can
+  // be NULL, e.g. when there's no edge broker; routes to it are skipped.
+  Adafruit_MQTT_Router(Adafruit_MQTT *local, Adafruit_MQTT *cloud,
+                       uint8_t defaultRoute = MQTT_ROUTE_CLOUD);
+
+  // Topics starting with prefix go to route.  The longest matching prefix
+  // wins.  Returns false if the rule table is full.
+  bool addRule(const char *prefix, uint8_t route);
+  uint8_t routeFor(const char *topic);
+
+  // Publish to every connected broker the topic is routed to.  Returns true
+  // if at least one of them took it.
+  bool publish(const char *topic, const char *payload, uint8_t qos = 0,
+               uint8_t priority = MQTT_PRIO_CONTROL);
+  bool publish(const char *topic, uint8_t *payload, uint16_t bLen, uint8_t qos = 0,
+               uint8_t priority = MQTT_PRIO_CONTROL);
+  bool publish(const Adafruit_MQTT_PublishHeader &header, uint8_t *payload, uint16_t bLen,
+               uint8_t priority = MQTT_PRIO_CONTROL);
+
+  // Subscribe on every broker the topic is routed to.  Like
+  // Adafruit_MQTT::subscribe() this must be called before the brokers
+  // connect.  The same subscription object is shared by both brokers.
+  bool subscribe(Adafruit_MQTT_Subscribe *sub);
+
+  // Check the local broker first, then wait up to timeout on the cloud one
+  // (or on the local one if the cloud is down).
+  Adafruit_MQTT_Subscribe *readSubscription(int16_t timeout = 0);
+
+  // Reconnect brokers whose backoff has run out, ping the connected ones
+  // and drop dead links.  Call once per loop().
+  void maintain();
+
+  // Drain both brokers' bulk queues.
+  void serviceQueue(uint16_t budget = MQTT_BULK_BUDGET);
+
+  // route is MQTT_ROUTE_LOCAL or MQTT_ROUTE_CLOUD.
+  bool connected(uint8_t route);
+  uint32_t connects(uint8_t route);
+  uint32_t connectFailures(uint8_t route);
+
+  // Publishes that had nowhere to go because every routed broker was down.
+  uint32_t publishesUnrouted;
+
+ private:
+  struct Link {
+    Adafruit_MQTT *mqtt;
+    bool up;
+    uint32_t backoff;
+    uint32_t nextAttempt;
+    uint32_t lastPing;
+    uint32_t connects;
+    uint32_t failures;
+  };
+
+  void maintainLink(Link &link);
+  Link *linkFor(uint8_t route);
+
+  Link links[2];  // [0] local, [1] cloud, matching the route bits
+
+  struct {
+    const char *prefix;
+    uint8_t len;
+    uint8_t route;
+  } rules[MQTT_ROUTER_MAXRULES];
+  uint8_t ruleCount;
+  uint8_t defaultRoute;
+};
+
+#endif
@@ -47,10 +47,127 @@ bool Adafruit_MQTT_SPARK::Update()
             return false;
         }
     }
+    else
+    {
+        maintainDns();
+    }
+    return true;
+}
+
+bool Adafruit_MQTT_SPARK::refreshDns()
+{
+    dnsTriedAt = millis();
+    IPAddress ip = WiFi.resolve(servername);
+    if ((uint32_t)ip == 0)
+    {
+        DEBUG_PRINTLN(F("DNS lookup failed, keeping cached addresses"));
+        return false;
+    }
+    cacheDns(ip);
     return true;
 }
 
+void Adafruit_MQTT_SPARK::cacheDns(IPAddress ip)
+{
+    uint32_t now = millis();
+    dnsResolvedAt = now;
+
+    for (uint8_t i = 0; i < dnsCount; i++)
+    {
+        if (dnsAddrs[i] == ip)
+        {
+            dnsSeenAt[i] = now;
+            return;
+        }
+    }
+    // New address: append it, or replace the entry the resolver returned
+    // longest ago, never the one in use.
+    uint8_t slot;
+    if (dnsCount < MQTT_DNS_MAXADDRS)
+    {
+        slot = dnsCount++;
+    }
+    else
+    {
+        slot = (dnsPreferred == 0) ? 1 : 0;
+        for (uint8_t i = 0; i < dnsCount; i++)
+        {
+            if (i != dnsPreferred && now - dnsSeenAt[i] > now - dnsSeenAt[slot])
+                slot = i;
+        }
+    }
+    dnsAddrs[slot] = ip;
+    dnsSeenAt[slot] = now;
+}
+
+// Don't block on an unreachable resolver every pass.
+bool Adafruit_MQTT_SPARK::dnsRetryDue()
+{
+    return dnsTriedAt == 0 || (millis() - dnsTriedAt) >= MQTT_DNS_RETRY_S * 1000UL;
+}
+
+void Adafruit_MQTT_SPARK::maintainDns()
+{
+    uint32_t now = millis();
+    if (dnsCount > 0 && (now - dnsResolvedAt) < dnsTtl * 750UL)
+        return;
+    if (!dnsRetryDue())
+        return;
+    refreshDns();
+}
+
+void Adafruit_MQTT_SPARK::dropDns(uint8_t idx)
+{
+    for (uint8_t i = idx; i + 1 < dnsCount; i++)
+    {
+        dnsAddrs[i] = dnsAddrs[i + 1];
+        dnsSeenAt[i] = dnsSeenAt[i + 1];
+    }
+    dnsCount--;
+    if (idx < dnsPreferred)
+        dnsPreferred--;
+    if (dnsPreferred >= dnsCount)
+        dnsPreferred = 0;
+}
+
+// Forget addresses no lookup has returned for a whole TTL.
+void Adafruit_MQTT_SPARK::expireDns()
+{
+    uint32_t now = millis();
+    for (uint8_t i = dnsCount; i-- > 0; )
+    {
+        if (now - dnsSeenAt[i] >= dnsTtl * 1000UL)
+            dropDns(i);
+    }
+}
+
 bool Adafruit_MQTT_SPARK::connectServer(){
+  // Anything still staged belongs to the old session.
+  txHead = txTail = txCount = 0;
+
+  expireDns();
+
+  // Go straight to a cached address, starting with the one that worked
+  // last.  One that fails is dropped, so a dead address costs a connect
+  // timeout once instead of on every reconnect; the next lookup brings it
+  // back if the name still points there.
+  uint8_t tries = dnsCount;
+  for (uint8_t i = 0; i < tries && dnsCount > 0; i++) {
+    uint8_t idx = dnsPreferred;
+    DEBUG_PRINT(F("Connecting to cached address #")); DEBUG_PRINTLN(idx);
+    if (client->connect(dnsAddrs[idx], portnum)) {
+      return true;
+    }
+    dropDns(idx);
+  }
+
+  // No usable cached address, let the client resolve the name itself.
+  // That's a lookup like refreshDns(), and backs off the same way.
+  if (!dnsRetryDue()) {
+    DEBUG_PRINTLN(F("No cached address, waiting to look the name up again"));
+    return false;
+  }
+  dnsTriedAt = millis();
   // Grab server name from flash and copy to buffer for name resolution.
   memset(buffer, 0, sizeof(buffer));
   strcpy((char *)buffer, servername);
@@ -58,15 +175,24 @@ bool Adafruit_MQTT_SPARK::connectServer(){
   // Connect and check for success (0 result).
   int r = client->connect((char *)buffer, portnum);
   DEBUG_PRINT(F("Connect result: ")); DEBUG_PRINTLN(r);
+  // cache the address the name resolved to, without a second lookup
+  if (r != 0) {
+    IPAddress ip = client->remoteIP();
+    if ((uint32_t)ip != 0)
+      cacheDns(ip);
+  }
   return r != 0;
 }
 
 bool Adafruit_MQTT_SPARK::disconnectServer() {
   // Stop connection if connected and return success (stop has no indication of
-  // failure).
+  // failure).  Give the staged data (usually the DISCONNECT packet) one
+  // chance to go out first.
   if (client->connected()) {
+    flushTx();
     client->stop();
   }
+  txHead = txTail = txCount = 0;
   return true;
 }
 
@@ -81,7 +207,15 @@ uint16_t Adafruit_MQTT_SPARK::readPacket(uint8_t *buffer, uint16_t maxlen,
   uint16_t len = 0;
   int16_t t = timeout;
 
+  // Whatever we're waiting for is probably the answer to something still
+  // sitting in the staging ring.
+  flushTx();
+
   while (client->connected() && (timeout >= 0)) {
+    // a packet the socket only took part of can't be answered until the
+    // rest goes out, keep pushing it while we wait
+    if (txCount > 0)
+      flushTx();
     //DEBUG_PRINT('.');
     while (client->available()) {
       //DEBUG_PRINT('!');
@@ -96,33 +230,68 @@ uint16_t Adafruit_MQTT_SPARK::readPacket(uint8_t *buffer, uint16_t maxlen,
         return len;
       }
     }
+    rxIdle();
     timeout -= MQTT_CLIENT_READINTERVAL_MS;
     delay(MQTT_CLIENT_READINTERVAL_MS);
   }
   return len;
 }
 
+int Adafruit_MQTT_SPARK::bytesAvailable() {
+  return client->connected() ? client->available() : 0;
+}
+
 bool Adafruit_MQTT_SPARK::sendPacket(uint8_t *buffer, uint16_t len) {
-  uint16_t ret = 0;
+  if (!client->connected()) {
+    DEBUG_PRINTLN(F("Connection failed!"));
+    return false;
+  }
 
-  while (len > 0) {
-    if (client->connected()) {
-      // send 250 bytes at most at a time, can adjust this later based on Client
+  // Make room if this packet won't fit behind what's already staged.
+  if (len > MQTT_CLIENT_TXBUFFERSIZE - txCount) {
+    flushTx();
+    if (len > MQTT_CLIENT_TXBUFFERSIZE - txCount) {
+      DEBUG_PRINTLN("Failed to send packet.");
+      return false;
+    }
+  }
 
-      uint16_t sendlen = min(len, 250);
-      //Serial.print("Sending: "); Serial.println(sendlen);
-      ret = client->write(buffer, sendlen);
-      DEBUG_PRINT(F("Client sendPacket returned: ")); DEBUG_PRINTLN(ret);
-      len -= ret;
+  // Copy into the ring, wrapping around the end if needed.
+  uint16_t first = min(len, (uint16_t)(MQTT_CLIENT_TXBUFFERSIZE - txHead));
+  memcpy(txBuffer + txHead, buffer, first);
+  memcpy(txBuffer, buffer + first, len - first);
+  txHead = (txHead + len) % MQTT_CLIENT_TXBUFFERSIZE;
+  txCount += len;
+  txPackets++;
+  return true;
+}
 
-      if (ret != sendlen) {
-	DEBUG_PRINTLN("Failed to send packet.");
-	return false;
-      }
-    } else {
+uint16_t Adafruit_MQTT_SPARK::flushTx() {
+  // Write up to the end of the ring, then the wrapped part, stopping as
+  // soon as the socket refuses or only takes part of a write.
+  while (txCount > 0) {
+    if (!client->connected()) {
       DEBUG_PRINTLN(F("Connection failed!"));
-      return false;
+      txHead = txTail = txCount = 0;
+      return 0;
+    }
+
+    uint16_t sendlen = min(txCount, (uint16_t)(MQTT_CLIENT_TXBUFFERSIZE - txTail));
+    int ret = client->write(txBuffer + txTail, sendlen);
+    DEBUG_PRINT(F("Client sendPacket returned: ")); DEBUG_PRINTLN(ret);
+    if (ret <= 0) {
+      // socket is full, try again next tick
+      break;
+    }
+    txWrites++;
+    txTail = (txTail + ret) % MQTT_CLIENT_TXBUFFERSIZE;
+    txCount -= ret;
+    if (ret != sendlen) {
+      // partial write, the rest goes next tick
+      break;
     }
   }
-  return true;
+  if (txCount == 0)
+    txHead = txTail = 0;
+  return txCount;
 }
@@ -31,6 +31,21 @@
 // How long to delay waiting for new data to be available in readPacket.
 #define MQTT_CLIENT_READINTERVAL_MS 10
 
+// Size of the outgoing staging ring.  Packets are queued here and written
+// to the socket together, see flushTx().
+#define MQTT_CLIENT_TXBUFFERSIZE 512
+
+// Broker address cache.  Device OS doesn't report the DNS TTL, so an
+// address is kept for MQTT_DNS_TTL_S seconds after a lookup last returned
+// it, and maintainDns() looks the name up again once 3/4 of that has
+// passed.  Round-robin DNS answers are collected, up to MQTT_DNS_MAXADDRS
+// distinct addresses.  An address that refuses a connect is dropped.  A
+// lookup, or a connect by name when no cached address works, isn't
+// attempted within MQTT_DNS_RETRY_S seconds of the last one.
+#define MQTT_DNS_MAXADDRS 4
+#define MQTT_DNS_TTL_S    300
+#define MQTT_DNS_RETRY_S  30
+
 
 // MQTT client implementation for a generic Arduino Client interface.  Can work
 // with almost all Arduino network hardware like ethernet shield, wifi shield,
@@ -40,13 +55,19 @@ class Adafruit_MQTT_SPARK : public Adafruit_MQTT {
   Adafruit_MQTT_SPARK(TCPClient *client, const char *server, uint16_t port,
                        const char *cid, const char *user, const char *pass):
     Adafruit_MQTT(server, port, cid, user, pass),
-    client(client)
+    txPackets(0), txWrites(0),
+    client(client),
+    txHead(0), txTail(0), txCount(0),
+    dnsCount(0), dnsPreferred(0), dnsResolvedAt(0), dnsTriedAt(0), dnsTtl(MQTT_DNS_TTL_S)
   {}
 
   Adafruit_MQTT_SPARK(TCPClient *client, const char *server, uint16_t port,
                        const char *user="", const char *pass=""):
     Adafruit_MQTT(server, port, user, pass),
-    client(client)
+    txPackets(0), txWrites(0),
+    client(client),
+    txHead(0), txTail(0), txCount(0),
+    dnsCount(0), dnsPreferred(0), dnsResolvedAt(0), dnsTriedAt(0), dnsTtl(MQTT_DNS_TTL_S)
   {}
   
   bool Update();
@@ -55,10 +76,49 @@ class Adafruit_MQTT_SPARK : public Adafruit_MQTT {
   bool disconnectServer();
   bool connected();
   uint16_t readPacket(uint8_t *buffer, uint16_t maxlen, int16_t timeout);
+  int bytesAvailable();
   bool sendPacket(uint8_t *buffer, uint16_t len);
 
+  // Write as much of the staged outgoing data as the socket will take right
+  // now.  Call once per loop() so everything queued during the pass goes out
+  // together; whatever the socket doesn't accept stays queued for the next
+  // call, and readPacket() keeps retrying it while it waits for a reply.
+  // Returns the number of bytes still pending.
+  uint16_t flushTx();
+  uint16_t txPending() { return txCount; }
+
+  // Resolve the broker name now and add the answer to the address cache.
+  // Returns false if the lookup failed (the cache is left as it was).
+  // WiFi.resolve() blocks, so this holds up the caller for the lookup:
+  // usually tens of ms, the resolver's timeout if DNS is unreachable.
+  bool refreshDns();
+  // Refresh the cache if it's getting old.  Update() calls this while
+  // connected, so the blocking lookup happens while the link is up
+  // instead of in front of a reconnect.
+  void maintainDns();
+  void setDnsTtl(uint32_t seconds) { dnsTtl = seconds; }
+  uint8_t dnsCached() { return dnsCount; }
+
+  // Packets queued and socket writes made, to see how well sends coalesce.
+  uint32_t txPackets;
+  uint32_t txWrites;
+
  private:
   TCPClient* client;
+
+  uint8_t txBuffer[MQTT_CLIENT_TXBUFFERSIZE];
+  uint16_t txHead, txTail, txCount;
+
+  IPAddress dnsAddrs[MQTT_DNS_MAXADDRS];
+  uint32_t dnsSeenAt[MQTT_DNS_MAXADDRS];   // millis() a lookup last returned it
+  uint8_t dnsCount, dnsPreferred;
+  uint32_t dnsResolvedAt, dnsTriedAt;
+  uint32_t dnsTtl;
+
+  void cacheDns(IPAddress ip);
+  bool dnsRetryDue();
+  void dropDns(uint8_t idx);
+  void expireDns();
 };
 
 
@@ -0,0 +1,255 @@
+// Typed subscriptions.
+//
+// Adafruit_MQTT_TypedSubscribe<T> parses the payload into T exactly once,
+// when the message arrives, and keeps the result in value().  A callback
+// taking T can be any callable, including lambdas with captures; it is
+// stored inline in the subscription, so nothing is allocated.
+//
+//   Adafruit_MQTT_TypedSubscribe<bool> pump(&mqtt, AIO_USERNAME "/feeds/turnonpump");
+//   pump.onValue([](bool on) { digitalWrite(PINPUMP, on); });
+//
+// Supported types: integers, bool ("1"/"0", "on"/"off", "true"/"false"),
+// enums (sent as their integer value) and Adafruit_MQTT_Fixed<N> for
+// decimals without floating point.  Payloads that don't parse, or don't
+// fit the type, are rejected: valid() goes false, value() keeps the last
+// good value and the callback isn't called.
+#ifndef _ADAFRUIT_MQTT_TYPED_H_
+#define _ADAFRUIT_MQTT_TYPED_H_
+
+#include <new>
+#include <limits>
+#include <type_traits>
+#include "Adafruit_MQTT.h"
+
+// Room for a callback's captures.  Two pointers' worth covers the usual
+// [&] or [this] lambda; capture a pointer to a struct if you need more.
+#define MQTT_CALLBACK_STORAGE (2 * sizeof(void *))
+
+// Non-allocating callable.  The callable is copied into inline storage, so
+// unlike a plain function_ref a lambda doesn't have to outlive the call
+// that registered it.
+template <typename Sig> class Adafruit_MQTT_Callback;
+
+template <typename R, typename... Args>
+class Adafruit_MQTT_Callback<R(Args...)> {
+ public:
+  Adafruit_MQTT_Callback() : invoker(0) {}
+
+  template <typename Fn>
+  Adafruit_MQTT_Callback(Fn f) : invoker(0) { assign(f); }
+
+  template <typename Fn>
+  Adafruit_MQTT_Callback &operator=(Fn f) { assign(f); return *this; }
+
+  R operator()(Args... args) { return invoker(storage, args...); }
+  explicit operator bool() const { return invoker != 0; }
+
+ private:
+  template <typename Fn>
+  void assign(Fn f) {
+    static_assert(sizeof(Fn) <= MQTT_CALLBACK_STORAGE,
+                  "callback captures too much, capture a pointer instead");
+    static_assert(std::is_trivially_copyable<Fn>::value,
+                  "callback captures must be trivially copyable");
+    new (storage) Fn(f);
+    invoker = &invoke<Fn>;
+  }
+
+  template <typename Fn>
+  static R invoke(void *s, Args... args) { return (*static_cast<Fn *>(s))(args...); }
+
+  alignas(void *) unsigned char storage[MQTT_CALLBACK_STORAGE];
+  R (*invoker)(void *, Args...);
+};
+
+// Decimal with a fixed number of digits after the point, stored as an
+// integer scaled by 10^Decimals.  "21.5" as Adafruit_MQTT_Fixed<2> is 2150.
+template <uint8_t Decimals>
+struct Adafruit_MQTT_Fixed {
+  int32_t raw;
+
+  static int32_t scale() {
+    int32_t s = 1;
+    for (uint8_t i = 0; i < Decimals; i++) s *= 10;
+    return s;
+  }
+  int32_t whole() const { return raw / scale(); }
+  float toFloat() const { return (float)raw / scale(); }
+};
+
+// Parsers //////////////////////////////////////////////////////////////////
+
+// Strict decimal integer: optional sign, then digits only.
+static inline bool mqttParseInteger(const uint8_t *s, uint16_t len, int64_t &out) {
+  uint16_t i = 0;
+  bool neg = false;
+  if (len > 0 && (s[0] == '-' || s[0] == '+')) {
+    neg = s[0] == '-';
+    i = 1;
+  }
+  if (i == len || len - i > 18)  // empty, or too long for int64
+    return false;
+  int64_t v = 0;
+  for (; i < len; i++) {
+    uint8_t d = s[i] - '0';
+    if (d > 9)
+      return false;
+    v = v * 10 + d;
+  }
+  out = neg ? -v : v;
+  return true;
+}
+
+// Decimal with at most 'decimals' digits after the point (extra digits are
+// truncated), scaled by 10^decimals.
+static inline bool mqttParseFixed(const uint8_t *s, uint16_t len, uint8_t decimals,
+                                  int64_t &out) {
+  if (decimals > 18)  // 10^decimals doesn't fit int64
+    return false;
+  uint16_t dot = 0;
+  while (dot < len && s[dot] != '.') dot++;
+
+  int64_t whole = 0;
+  bool neg = len > 0 && s[0] == '-';
+  if (dot == 0 || (dot == 1 && (s[0] == '-' || s[0] == '+'))) {
+    // ".5" or "-.5"
+    if (dot == len)
+      return false;
+  } else if (!mqttParseInteger(s, dot, whole)) {
+    return false;
+  }
+
+  int64_t frac = 0;
+  uint8_t n = 0;
+  for (uint16_t i = dot + 1; i < len; i++) {
+    uint8_t d = s[i] - '0';
+    if (d > 9)
+      return false;
+    if (n < decimals) {
+      frac = frac * 10 + d;
+      n++;
+    }
+  }
+  if (dot + 1 == len)  // "12."
+    return false;
+  for (; n < decimals; n++) frac *= 10;
+
+  int64_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+  // an 18 digit whole part scaled up can overflow int64
+  int64_t magnitude = neg ? -whole : whole;
+  if (magnitude > (INT64_MAX - frac) / scale)
+    return false;
+  out = neg ? whole * scale - frac : whole * scale + frac;
+  return true;
+}
+
+static inline bool mqttParseBool(const uint8_t *s, uint16_t len, bool &out) {
+  if (len == 1 && (s[0] == '1' || s[0] == '0')) {
+    out = s[0] == '1';
+    return true;
+  }
+  if ((len == 2 && strncasecmp((const char *)s, "on", 2) == 0) ||
+      (len == 4 && strncasecmp((const char *)s, "true", 4) == 0)) {
+    out = true;
+    return true;
+  }
+  if ((len == 3 && strncasecmp((const char *)s, "off", 3) == 0) ||
+      (len == 5 && strncasecmp((const char *)s, "false", 5) == 0)) {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+template <typename T, typename Enable = void>
+struct Adafruit_MQTT_Parser;  // no parser for this type
+
+template <typename T>
+struct Adafruit_MQTT_Parser<T, typename std::enable_if<std::is_integral<T>::value &&
+                                                       !std::is_same<T, bool>::value>::type> {
+  static bool parse(const uint8_t *s, uint16_t len, T &out) {
+    int64_t v;
+    if (!mqttParseInteger(s, len, v))
+      return false;
+    if (v < (int64_t)std::numeric_limits<T>::min() ||
+        v > (int64_t)std::numeric_limits<T>::max())
+      return false;
+    out = (T)v;
+    return true;
+  }
+};
+
+template <>
+struct Adafruit_MQTT_Parser<bool> {
+  static bool parse(const uint8_t *s, uint16_t len, bool &out) {
+    return mqttParseBool(s, len, out);
+  }
+};
+
+template <typename T>
+struct Adafruit_MQTT_Parser<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+  static bool parse(const uint8_t *s, uint16_t len, T &out) {
+    typename std::underlying_type<T>::type v;
+    if (!Adafruit_MQTT_Parser<typename std::underlying_type<T>::type>::parse(s, len, v))
+      return false;
+    out = (T)v;
+    return true;
+  }
+};
+
+template <uint8_t Decimals>
+struct Adafruit_MQTT_Parser<Adafruit_MQTT_Fixed<Decimals> > {
+  static bool parse(const uint8_t *s, uint16_t len, Adafruit_MQTT_Fixed<Decimals> &out) {
+    int64_t v;
+    if (!mqttParseFixed(s, len, Decimals, v))
+      return false;
+    if (v < INT32_MIN || v > INT32_MAX)
+      return false;
+    out.raw = (int32_t)v;
+    return true;
+  }
+};
+
+// Typed subscription ////////////////////////////////////////////////////////
+
+template <typename T>
+class Adafruit_MQTT_TypedSubscribe : public Adafruit_MQTT_Subscribe {
+ public:
+  Adafruit_MQTT_TypedSubscribe(Adafruit_MQTT *mqttserver, const char *feedname, uint8_t q=0) :
+    Adafruit_MQTT_Subscribe(mqttserver, feedname, q),
+    _value(),
+    _valid(false) {
+    parse_hook = &parseThunk;
+    dispatch_hook = &dispatchThunk;
+  }
+
+  // Called from Adafruit_MQTT::processPackets() with each valid value.
+  template <typename Fn>
+  void onValue(Fn f) { callback = f; }
+
+  // Last successfully parsed value, and whether the latest message parsed.
+  const T &value() const { return _value; }
+  bool valid() const { return _valid; }
+
+ private:
+  static void parseThunk(Adafruit_MQTT_Subscribe *sub) {
+    Adafruit_MQTT_TypedSubscribe *self = static_cast<Adafruit_MQTT_TypedSubscribe *>(sub);
+    T v;
+    self->_valid = Adafruit_MQTT_Parser<T>::parse(sub->lastread, sub->datalen, v);
+    if (self->_valid)
+      self->_value = v;
+  }
+
+  static void dispatchThunk(Adafruit_MQTT_Subscribe *sub) {
+    Adafruit_MQTT_TypedSubscribe *self = static_cast<Adafruit_MQTT_TypedSubscribe *>(sub);
+    if (self->_valid && self->callback)
+      self->callback(self->_value);
+  }
+
+  T _value;
+  bool _valid;
+  Adafruit_MQTT_Callback<void(T)> callback;
+};
+
+#endif
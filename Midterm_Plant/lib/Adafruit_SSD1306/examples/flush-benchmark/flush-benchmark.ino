@@ -0,0 +1,77 @@
+#include "Adafruit_SSD1306.h"
+#include "Adafruit_GFX.h"
+
+// Frame flush benchmark for an I2C SSD1306.  Times a full display() and a
+// one-line update at each bus speed and Wire buffer size, so you can see
+// what the pull-ups and the platform actually deliver.  Results go to the
+// serial monitor.
+
+#define OLED_RESET -1
+#define OLED_ADDR  0x3C
+Adafruit_SSD1306 oled(OLED_RESET);
+
+// Room for a whole frame in one transaction; see Adafruit_SSD1306.h.
+hal_i2c_config_t acquireWireBuffer() {
+  hal_i2c_config_t config = {
+    .size = sizeof(hal_i2c_config_t),
+    .version = HAL_I2C_CONFIG_VERSION_1,
+    .rx_buffer = new (std::nothrow) uint8_t[32],
+    .rx_buffer_size = 32,
+    .tx_buffer = new (std::nothrow) uint8_t[SSD1306_WIRE_FRAME_BUFFER],
+    .tx_buffer_size = SSD1306_WIRE_FRAME_BUFFER
+  };
+  return config;
+}
+
+const uint32_t speeds[] = { 100000, 400000, 1000000 };
+const uint16_t buffers[] = { 17, SSD1306_WIRE_BUFFER, 256, SSD1306_WIRE_FRAME_BUFFER };
+const uint8_t FRAMES = 20;
+
+void fillPattern() {
+  for (int16_t y=0; y<oled.height(); y+=4)
+    oled.drawFastHLine(0, y, oled.width(), WHITE);
+}
+
+// average microseconds per display()
+uint32_t timeFlush(bool full, uint8_t tick) {
+  uint32_t total = 0;
+  for (uint8_t i=0; i<FRAMES; i++) {
+    if (full) {
+      oled.invalidate();
+    } else {
+      oled.fillRect(0, 0, 48, 8, BLACK);
+      oled.setCursor(0, 0);
+      oled.printf("%02u:%02u", tick, i);
+    }
+    uint32_t start = micros();
+    oled.display();
+    total += micros() - start;
+  }
+  return total / FRAMES;
+}
+
+void setup() {
+  Serial.begin(9600);
+  waitFor(Serial.isConnected, 10000);
+  oled.setTextColor(WHITE);
+  oled.setTextSize(1);
+
+  Serial.println("speed(Hz)  buffer  full frame(us)  fps    clock line(us)  bytes");
+  uint8_t tick = 0;
+  for (uint8_t s=0; s<sizeof(speeds)/sizeof(speeds[0]); s++) {
+    oled.setBusSpeed(speeds[s]);
+    for (uint8_t b=0; b<sizeof(buffers)/sizeof(buffers[0]); b++) {
+      oled.setWireBufferSize(buffers[b]);
+      oled.begin(SSD1306_SWITCHCAPVCC, OLED_ADDR);
+      oled.clearDisplay();
+      fillPattern();
+      uint32_t full = timeFlush(true, tick);
+      uint32_t line = timeFlush(false, tick++);
+      Serial.printf("%9lu  %6u  %14lu  %5.1f  %14lu  %5u\n",
+                    speeds[s], buffers[b], full, 1e6 / full, line, oled.lastFlushBytes());
+    }
+  }
+}
+
+void loop() {
+}
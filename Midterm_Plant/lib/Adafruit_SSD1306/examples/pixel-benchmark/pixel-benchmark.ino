@@ -0,0 +1,131 @@
+#include "Adafruit_SSD1306.h"
+#include "Adafruit_GFX.h"
+
+// Drawing throughput benchmark.  Draws into the framebuffer only, so no
+// panel is needed and the numbers measure the drawing code, not the bus.
+// Reports pixels per second for each primitive in each rotation on the
+// serial monitor, for the driver as it is and for the generic path.
+//
+// It also builds on a PC, see Midterm_Plant/host.
+
+#define OLED_RESET -1
+Adafruit_SSD1306 oled(OLED_RESET);
+
+// The driver without its own lines, characters and fills: those go through
+// Adafruit_GFX's generic code, pixel by pixel, as they did before the
+// driver had fast paths.  The byte-wise horizontal and vertical lines stay.
+// Shares the framebuffer with oled.
+class GenericDisplay : public Adafruit_SSD1306 {
+ public:
+  GenericDisplay() : Adafruit_SSD1306(OLED_RESET) {}
+
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    Adafruit_GFX::drawLine(x0, y0, x1, y1, color);
+  }
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                uint16_t bg, uint8_t size) {
+    Adafruit_GFX::drawChar(x, y, c, color, bg, size);
+  }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    Adafruit_GFX::fillRect(x, y, w, h, color);
+  }
+  void fillScreen(uint16_t color) {
+    Adafruit_GFX::fillScreen(color);
+  }
+};
+GenericDisplay generic;
+
+const uint16_t REPEAT = 200;
+
+typedef uint32_t (*Primitive)(Adafruit_SSD1306 &d, uint16_t i);   // draws once, returns pixels touched
+
+uint32_t pixels(Adafruit_SSD1306 &d, uint16_t i) {
+  for (int16_t y=0; y<d.height(); y++)
+    d.drawPixel((i + y * 7) % d.width(), y, i & 1);
+  return d.height();
+}
+
+uint32_t lines(Adafruit_SSD1306 &d, uint16_t i) {
+  int16_t w = d.width() - 1, h = d.height() - 1;
+  int16_t x = i % w, y = i % h;
+  d.drawLine(0, y, w, h - y, i & 1);
+  d.drawLine(x, 0, w - x, h, i & 1);
+  return (w + 1) + (h + 1);
+}
+
+uint32_t fills(Adafruit_SSD1306 &d, uint16_t i) {
+  d.fillRect(i % 8, i % 5, 40, 20, i & 1);
+  return 40 * 20;
+}
+
+// the sketch's way of blanking a text line before redrawing it
+uint32_t clearRows(Adafruit_SSD1306 &d, uint16_t i) {
+  d.fillRect(0, i % (d.height() - 10), d.width(), 10, BLACK);
+  return d.width() * 10;
+}
+
+uint32_t screens(Adafruit_SSD1306 &d, uint16_t i) {
+  d.fillScreen(i & 1);
+  return d.width() * d.height();
+}
+
+// Short enough to stay on screen at size 2 in every rotation (60 pixels on
+// the 64 pixel side), so no rotation falls back to the clipped path.
+const char TEXT[] = "72.5F";
+
+uint32_t text(Adafruit_SSD1306 &d, uint16_t i, uint8_t size) {
+  d.setTextSize(size);
+  d.setTextColor(i & 1);
+  d.setCursor(0, (i % 2) * 8 * size);
+  d.print(TEXT);
+  return (sizeof(TEXT) - 1) * 6 * 8 * size * size;
+}
+
+uint32_t text1(Adafruit_SSD1306 &d, uint16_t i) { return text(d, i, 1); }
+uint32_t text2(Adafruit_SSD1306 &d, uint16_t i) { return text(d, i, 2); }
+
+struct {
+  const char *name;
+  Primitive draw;
+} primitives[] = {
+  { "drawPixel", pixels },
+  { "drawLine",  lines },
+  { "fillRect",  fills },
+  { "clear 10",  clearRows },
+  { "fillScreen", screens },
+  { "text x1",   text1 },
+  { "text x2",   text2 },
+};
+
+// Mpixels/s for one primitive on one display
+double rate(Adafruit_SSD1306 &d, Primitive draw) {
+  uint32_t count = 0;
+  uint32_t start = micros();
+  for (uint16_t i=0; i<REPEAT; i++)
+    count += draw(d, i);
+  uint32_t us = micros() - start;
+  return (double)count / (us ? us : 1);
+}
+
+void setup() {
+  Serial.begin(9600);
+  waitFor(Serial.isConnected, 10000);
+  oled.setTextWrap(false);
+  generic.setTextWrap(false);
+
+  Serial.println("primitive   rotation  generic Mpx/s  driver Mpx/s  speedup");
+  for (uint8_t p=0; p<sizeof(primitives)/sizeof(primitives[0]); p++) {
+    for (uint8_t r=0; r<4; r++) {
+      oled.setRotation(r);
+      generic.setRotation(r);
+      double slow = rate(generic, primitives[p].draw);
+      double fast = rate(oled, primitives[p].draw);
+      Serial.printf("%-10s  %8u  %13.2f  %12.2f  %6.1fx\n", primitives[p].name, r,
+                    slow, fast, fast / slow);
+    }
+  }
+  oled.setRotation(0);
+}
+
+void loop() {
+}
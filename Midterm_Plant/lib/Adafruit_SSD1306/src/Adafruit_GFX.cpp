@@ -637,6 +637,10 @@ size_t Adafruit_GFX::write(uint8_t c) {
 }
 
 // Draw a character
+const unsigned char *Adafruit_GFX::glyph(unsigned char c) {
+  return font + c * 5;
+}
+
 void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
 			    uint16_t color, uint16_t bg, uint8_t size) {
 
@@ -92,6 +92,12 @@ static uint8_t buffer[SSD1306_LCDHEIGHT * SSD1306_LCDWIDTH / 8] = {
 
 
 
+// widen the page's dirty column range to cover x0..x1
+inline void Adafruit_SSD1306::markDirty(uint8_t page, uint8_t x0, uint8_t x1) {
+  if (x0 < dirtyLo[page]) dirtyLo[page] = x0;
+  if (x1 > dirtyHi[page]) dirtyHi[page] = x1;
+}
+
 // the most basic function, set a single pixel
 void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
   if ((x < 0) || (x >= width()) || (y < 0) || (y >= height()))
@@ -113,6 +119,8 @@ void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
     break;
   }  
 
+  markDirty(y/8, x, x);
+
   // x is which column
   if (color == WHITE) 
     buffer[x+ (y/8)*SSD1306_LCDWIDTH] |= (1 << (y&7));  
@@ -120,6 +128,265 @@ void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
     buffer[x+ (y/8)*SSD1306_LCDWIDTH] &= ~(1 << (y&7)); 
 }
 
+// Pixel pipeline.  Rotation and colour are template parameters, so a
+// primitive picks its instantiation once and the inner loops are plain
+// stores into the page buffer: no virtual call, bounds check or rotation
+// switch per pixel.  Callers clip the primitive and mark it dirty first.
+
+// rotated coordinates to panel coordinates, as in drawPixel()
+template <uint8_t ROT>
+static inline __attribute__((always_inline)) void toPanel(int16_t &x, int16_t &y) {
+  int16_t t = x;
+  if (ROT == 1) {
+    x = SSD1306_LCDWIDTH - 1 - y;
+    y = t;
+  } else if (ROT == 2) {
+    x = SSD1306_LCDWIDTH - 1 - x;
+    y = SSD1306_LCDHEIGHT - 1 - y;
+  } else if (ROT == 3) {
+    x = y;
+    y = SSD1306_LCDHEIGHT - 1 - t;
+  }
+}
+
+template <uint8_t ROT, bool SET>
+static inline __attribute__((always_inline)) void plot(int16_t x, int16_t y) {
+  toPanel<ROT>(x, y);
+  uint8_t *p = &buffer[x + (y / 8) * SSD1306_LCDWIDTH];
+  if (SET)
+    *p |= 1 << (y & 7);
+  else
+    *p &= ~(1 << (y & 7));
+}
+
+// Run F::run<ROT, SET>(args...) for the current rotation and colour.
+template <class F, class... Args>
+static inline void dispatch(uint8_t rot, uint16_t color, Args... args) {
+  bool set = (color == WHITE);
+  switch (rot & 3) {
+  case 0: set ? F::template run<0, true>(args...) : F::template run<0, false>(args...); break;
+  case 1: set ? F::template run<1, true>(args...) : F::template run<1, false>(args...); break;
+  case 2: set ? F::template run<2, true>(args...) : F::template run<2, false>(args...); break;
+  case 3: set ? F::template run<3, true>(args...) : F::template run<3, false>(args...); break;
+  }
+}
+
+// Bresenham, stepping along x; steep lines come in with x and y swapped.
+struct LineFast {
+  template <uint8_t ROT, bool SET>
+  static void run(int16_t x0, int16_t y0, int16_t x1, int16_t y1, bool steep) {
+    int16_t dx = x1 - x0;
+    int16_t dy = abs(y1 - y0);
+    int16_t err = dx / 2;
+    int16_t ystep = (y0 < y1) ? 1 : -1;
+
+    if (steep) {
+      for (; x0 <= x1; x0++) {
+        plot<ROT, SET>(y0, x0);
+        err -= dy;
+        if (err < 0) {
+          y0 += ystep;
+          err += dx;
+        }
+      }
+    } else {
+      for (; x0 <= x1; x0++) {
+        plot<ROT, SET>(x0, y0);
+        err -= dy;
+        if (err < 0) {
+          y0 += ystep;
+          err += dx;
+        }
+      }
+    }
+  }
+};
+
+// The lit pixels of a glyph, as size x size blocks.
+struct CharFast {
+  template <uint8_t ROT, bool SET>
+  static void run(int16_t x, int16_t y, const unsigned char *g, uint8_t size) {
+    for (int8_t i = 0; i < 5; i++) {   // the sixth column is blank
+      uint8_t line = g[i];
+      for (int8_t j = 0; line; j++, line >>= 1) {
+        if (!(line & 1))
+          continue;
+        if (size == 1) {
+          plot<ROT, SET>(x + i, y + j);
+        } else {
+          int16_t bx = x + i * size, by = y + j * size;
+          for (uint8_t u = 0; u < size; u++)
+            for (uint8_t v = 0; v < size; v++)
+              plot<ROT, SET>(bx + u, by + v);
+        }
+      }
+    }
+  }
+};
+
+// Glyph blitter for rotations 0 and 2, where a font column is still a
+// panel column.  Each column byte is stretched to size * 8 bits, shifted to
+// y's offset within its page and merged into the two to five page bytes it
+// covers, so a character is a few dozen byte operations instead of 48
+// pixels.  Rotation 2 is the same cell mirrored both ways.
+
+static inline uint8_t reverseBits(uint8_t b) {
+  b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+  b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+  b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+  return b;
+}
+
+// each bit of line becomes size bits
+static inline uint32_t stretchBits(uint8_t line, uint8_t size) {
+  if (size == 1)
+    return line;
+  uint32_t block = (1UL << size) - 1, bits = 0;
+  for (uint8_t j = 0; line; j++, line >>= 1)
+    if (line & 1)
+      bits |= block << (j * size);
+  return bits;
+}
+
+static void blitChar(int16_t x, int16_t y, const unsigned char *g, bool flip,
+                     bool fgSet, bool opaque, bool bgSet, uint8_t size) {
+  uint8_t rows = 8 * size;
+  uint32_t cell = (rows == 32) ? 0xFFFFFFFF : (1UL << rows) - 1;
+  if (flip) {
+    x = SSD1306_LCDWIDTH - x - 6 * size;
+    y = SSD1306_LCDHEIGHT - y - rows;
+  }
+  uint8_t shift = y & 7;
+  uint8_t pages = (shift + rows + 7) / 8;
+  uint8_t *col = buffer + (y / 8) * SSD1306_LCDWIDTH + x;
+
+  for (uint8_t i = 0; i < 6; i++) {
+    uint8_t gi = flip ? 5 - i : i;
+    uint8_t line = (gi < 5) ? g[gi] : 0;   // the sixth column is blank
+    if (flip)
+      line = reverseBits(line);
+    uint32_t fg = stretchBits(line, size);
+
+    // bits to set and bits to clear in this column of the cell
+    uint64_t set = 0, clr = 0;
+    if (fgSet) set = fg; else clr = fg;
+    if (opaque) {
+      if (bgSet) set |= ~fg & cell; else clr |= ~fg & cell;
+    }
+    set <<= shift;
+    clr <<= shift;
+
+    for (uint8_t u = 0; u < size; u++, col++) {
+      uint8_t *p = col;
+      for (uint8_t k = 0; k < pages; k++, p += SSD1306_LCDWIDTH)
+        *p = (*p | (uint8_t)(set >> (8 * k))) & ~(uint8_t)(clr >> (8 * k));
+    }
+  }
+}
+
+// Corners of a rectangle in rotated coordinates to the panel's, ordered so
+// x0 <= x1 and y0 <= y1.
+static void rectToPanel(uint8_t rot, int16_t &x0, int16_t &y0, int16_t &x1, int16_t &y1) {
+  switch (rot) {
+  case 1: toPanel<1>(x0, y0); toPanel<1>(x1, y1); break;
+  case 2: toPanel<2>(x0, y0); toPanel<2>(x1, y1); break;
+  case 3: toPanel<3>(x0, y0); toPanel<3>(x1, y1); break;
+  }
+  if (x0 > x1) swap(x0, x1);
+  if (y0 > y1) swap(y0, y1);
+}
+
+// Mark a rectangle in rotated coordinates dirty; it must be on screen.
+void Adafruit_SSD1306::markRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t x0 = x, y0 = y, x1 = x + w - 1, y1 = y + h - 1;
+  rectToPanel(rotation, x0, y0, x1, y1);
+  for (uint8_t page = y0 / 8; page <= y1 / 8; page++)
+    markDirty(page, x0, x1);
+}
+
+// A rectangle is a run of columns in each page it touches: the top and
+// bottom pages take a mask, the pages in between are whole bytes.
+void Adafruit_SSD1306::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > _width) w = _width - x;
+  if (y + h > _height) h = _height - y;
+  if (w <= 0 || h <= 0)
+    return;
+
+  int16_t x0 = x, y0 = y, x1 = x + w - 1, y1 = y + h - 1;
+  rectToPanel(rotation, x0, y0, x1, y1);
+
+  uint8_t page0 = y0 / 8, page1 = y1 / 8;
+  uint8_t top = 0xFF << (y0 & 7), bottom = 0xFF >> (7 - (y1 & 7));
+  if (page0 == page1)
+    top &= bottom;
+  uint8_t n = x1 - x0 + 1;
+
+  for (uint8_t page = page0; page <= page1; page++) {
+    markDirty(page, x0, x1);
+    uint8_t *p = buffer + page * SSD1306_LCDWIDTH + x0;
+    uint8_t mask = (page == page0) ? top : (page == page1) ? bottom : 0xFF;
+    if (mask == 0xFF)
+      memset(p, color == WHITE ? 0xFF : 0x00, n);
+    else if (color == WHITE)
+      for (uint8_t i = 0; i < n; i++) p[i] |= mask;
+    else
+      for (uint8_t i = 0; i < n; i++) p[i] &= ~mask;
+  }
+}
+
+void Adafruit_SSD1306::fillScreen(uint16_t color) {
+  memset(buffer, color == WHITE ? 0xFF : 0x00, (SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8));
+  invalidate();
+}
+
+void Adafruit_SSD1306::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  if (y0 == y1) {
+    drawFastHLine(min(x0, x1), y0, abs(x1 - x0) + 1, color);
+    return;
+  }
+  if (x0 == x1) {
+    drawFastVLine(x0, min(y0, y1), abs(y1 - y0) + 1, color);
+    return;
+  }
+  // partly off screen: the generic code clips pixel by pixel
+  if (x0 < 0 || x1 < 0 || y0 < 0 || y1 < 0 ||
+      x0 >= _width || x1 >= _width || y0 >= _height || y1 >= _height) {
+    Adafruit_GFX::drawLine(x0, y0, x1, y1, color);
+    return;
+  }
+
+  markRect(min(x0, x1), min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1);
+  bool steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    swap(x0, y0);
+    swap(x1, y1);
+  }
+  if (x0 > x1) {
+    swap(x0, x1);
+    swap(y0, y1);
+  }
+  dispatch<LineFast>(rotation, color, x0, y0, x1, y1, steep);
+}
+
+void Adafruit_SSD1306::drawChar(int16_t x, int16_t y, unsigned char c,
+                                uint16_t color, uint16_t bg, uint8_t size) {
+  if (x < 0 || y < 0 || x + 6 * size > _width || y + 8 * size > _height) {
+    Adafruit_GFX::drawChar(x, y, c, color, bg, size);
+    return;
+  }
+  markRect(x, y, 6 * size, 8 * size);
+  if (size <= SSD1306_BLIT_MAXSIZE && !(rotation & 1)) {
+    blitChar(x, y, glyph(c), rotation == 2, color == WHITE, bg != color, bg == WHITE, size);
+    return;
+  }
+  // an opaque background is the whole cell in bg with the glyph on top
+  if (bg != color)
+    fillRect(x, y, 6 * size, 8 * size, bg);
+  dispatch<CharFast>(rotation, color, x, y, glyph(c), size);
+}
+
 // constructor for software SPI - we indicate DataCommand, ChipSelect, Reset 
 Adafruit_SSD1306::Adafruit_SSD1306(int8_t SID, int8_t SCLK, int8_t DC, int8_t RST, int8_t CS) : Adafruit_GFX(SSD1306_LCDWIDTH, SSD1306_LCDHEIGHT) {
   cs = CS;
@@ -128,6 +395,14 @@ Adafruit_SSD1306::Adafruit_SSD1306(int8_t SID, int8_t SCLK, int8_t DC, int8_t RS
   sclk = SCLK;
   sid = SID;
   hwSPI = false;
+  busSpeed = 0;
+  busSpeedApplied = false;
+  wireBurst = SSD1306_WIRE_BUFFER - 1;
+  async = false;
+  flushBusy = false;
+  coalesced = 0;
+  i2cErrorCount = 0;
+  invalidate();
 }
 
 // constructor for hardware SPI - we indicate DataCommand, ChipSelect, Reset 
@@ -136,6 +411,14 @@ Adafruit_SSD1306::Adafruit_SSD1306(int8_t DC, int8_t RST, int8_t CS) : Adafruit_
   rst = RST;
   cs = CS;
   hwSPI = true;
+  busSpeed = 0;
+  busSpeedApplied = false;
+  wireBurst = SSD1306_WIRE_BUFFER - 1;
+  async = false;
+  flushBusy = false;
+  coalesced = 0;
+  i2cErrorCount = 0;
+  invalidate();
 }
 
 // initializer for I2C - we only indicate the reset pin!
@@ -143,10 +426,58 @@ Adafruit_SSD1306::Adafruit_SSD1306(int8_t reset) :
 Adafruit_GFX(SSD1306_LCDWIDTH, SSD1306_LCDHEIGHT) {
   sclk = dc = cs = sid = -1;
   rst = reset;
+  busSpeed = 0;
+  busSpeedApplied = false;
+  wireBurst = SSD1306_WIRE_BUFFER - 1;
+  async = false;
+  flushBusy = false;
+  coalesced = 0;
+  i2cErrorCount = 0;
+  invalidate();
 }
   
 
+// Power-up command sequence for a panel height and supply, worked out at
+// compile time so begin() sends it straight from flash.
+struct SSD1306_InitSequence {
+  uint8_t len;
+  uint8_t bytes[25];
+};
+
+static constexpr SSD1306_InitSequence initSequence(uint8_t height, uint8_t vccstate) {
+  return { 25, {
+    SSD1306_DISPLAYOFF,
+    SSD1306_SETDISPLAYCLOCKDIV, 0x80,                       // the suggested ratio 0x80
+    SSD1306_SETMULTIPLEX, (uint8_t)(height - 1),
+    SSD1306_SETDISPLAYOFFSET, 0x0,                          // no offset
+    SSD1306_SETSTARTLINE | 0x0,                             // line #0
+    SSD1306_CHARGEPUMP, (uint8_t)(vccstate == SSD1306_EXTERNALVCC ? 0x10 : 0x14),
+    SSD1306_MEMORYMODE, 0x00,                               // 0x0 act like ks0108
+    SSD1306_SEGREMAP | 0x1,
+    SSD1306_COMSCANDEC,
+    SSD1306_SETCOMPINS, (uint8_t)(height == 64 ? 0x12 : 0x02),
+    SSD1306_SETCONTRAST, (uint8_t)(height != 64 ? 0x8F : vccstate == SSD1306_EXTERNALVCC ? 0x9F : 0xCF),
+    SSD1306_SETPRECHARGE, (uint8_t)(vccstate == SSD1306_EXTERNALVCC ? 0x22 : 0xF1),
+    SSD1306_SETVCOMDETECT, 0x40,
+    SSD1306_DISPLAYALLON_RESUME,
+    SSD1306_NORMALDISPLAY,
+    SSD1306_DISPLAYON                                       //--turn on oled panel
+  } };
+}
+
+// internal charge pump first, then external VCC
+static constexpr SSD1306_InitSequence init128x64[2] = {
+  initSequence(64, SSD1306_SWITCHCAPVCC), initSequence(64, SSD1306_EXTERNALVCC)
+};
+static constexpr SSD1306_InitSequence init128x32[2] = {
+  initSequence(32, SSD1306_SWITCHCAPVCC), initSequence(32, SSD1306_EXTERNALVCC)
+};
+
 void Adafruit_SSD1306::begin(uint8_t vccstate, uint8_t i2caddr) {
+  // don't reset the panel under a frame the worker is sending
+  if (async)
+    awaitFlush(100);
+
   _vccstate = vccstate;
   _i2caddr = i2caddr;
 
@@ -169,7 +500,14 @@ void Adafruit_SSD1306::begin(uint8_t vccstate, uint8_t i2caddr) {
     }
   else
   {
-    // I2C Init
+    // I2C Init.  Device OS only takes a new speed while the bus is down,
+    // and the BME280 or another device may have started it already.
+    if (busSpeed && !busSpeedApplied) {
+      if (Wire.isEnabled())
+        Wire.end();
+      Wire.setSpeed(busSpeed);
+      busSpeedApplied = true;
+    }
     Wire.begin();
   }
 
@@ -186,80 +524,48 @@ void Adafruit_SSD1306::begin(uint8_t vccstate, uint8_t i2caddr) {
   digitalWrite(rst, HIGH);
   // turn on VCC (9V?)
 
-   #if defined SSD1306_128_32
-    // Init sequence for 128x32 OLED module
-    ssd1306_command(SSD1306_DISPLAYOFF);                    // 0xAE
-    ssd1306_command(SSD1306_SETDISPLAYCLOCKDIV);            // 0xD5
-    ssd1306_command(0x80);                                  // the suggested ratio 0x80
-    ssd1306_command(SSD1306_SETMULTIPLEX);                  // 0xA8
-    ssd1306_command(0x1F);
-    ssd1306_command(SSD1306_SETDISPLAYOFFSET);              // 0xD3
-    ssd1306_command(0x0);                                   // no offset
-    ssd1306_command(SSD1306_SETSTARTLINE | 0x0);            // line #0
-    ssd1306_command(SSD1306_CHARGEPUMP);                    // 0x8D
-    if (vccstate == SSD1306_EXTERNALVCC) 
-      { ssd1306_command(0x10); }
-    else 
-      { ssd1306_command(0x14); }
-    ssd1306_command(SSD1306_MEMORYMODE);                    // 0x20
-    ssd1306_command(0x00);                                  // 0x0 act like ks0108
-	ssd1306_command(SSD1306_SEGREMAP | 0x1);
-    ssd1306_command(SSD1306_COMSCANDEC);
-    ssd1306_command(SSD1306_SETCOMPINS);                    // 0xDA
-    ssd1306_command(0x02);
-    ssd1306_command(SSD1306_SETCONTRAST);                   // 0x81
-    ssd1306_command(0x8F);
-    ssd1306_command(SSD1306_SETPRECHARGE);                  // 0xd9
-    if (vccstate == SSD1306_EXTERNALVCC) 
-      { ssd1306_command(0x22); }
-    else 
-      { ssd1306_command(0xF1); }
-    ssd1306_command(SSD1306_SETVCOMDETECT);                 // 0xDB
-    ssd1306_command(0x40);
-    ssd1306_command(SSD1306_DISPLAYALLON_RESUME);           // 0xA4
-    ssd1306_command(SSD1306_NORMALDISPLAY);                 // 0xA6
-  #endif
-
-  #if defined SSD1306_128_64
-    // Init sequence for 128x64 OLED module
-    ssd1306_command(SSD1306_DISPLAYOFF);                    // 0xAE
-    ssd1306_command(SSD1306_SETDISPLAYCLOCKDIV);            // 0xD5
-    ssd1306_command(0x80);                                  // the suggested ratio 0x80
-    ssd1306_command(SSD1306_SETMULTIPLEX);                  // 0xA8
-    ssd1306_command(0x3F);
-    ssd1306_command(SSD1306_SETDISPLAYOFFSET);              // 0xD3
-    ssd1306_command(0x0);                                   // no offset
-    ssd1306_command(SSD1306_SETSTARTLINE | 0x0);            // line #0
-    ssd1306_command(SSD1306_CHARGEPUMP);                    // 0x8D
-    if (vccstate == SSD1306_EXTERNALVCC) 
-      { ssd1306_command(0x10); }
-    else 
-      { ssd1306_command(0x14); }
-    ssd1306_command(SSD1306_MEMORYMODE);                    // 0x20
-    ssd1306_command(0x00);                                  // 0x0 act like ks0108
-    ssd1306_command(SSD1306_SEGREMAP | 0x1);
-    ssd1306_command(SSD1306_COMSCANDEC);
-    ssd1306_command(SSD1306_SETCOMPINS);                    // 0xDA
-    ssd1306_command(0x12);
-    ssd1306_command(SSD1306_SETCONTRAST);                   // 0x81
-    if (vccstate == SSD1306_EXTERNALVCC) 
-      { ssd1306_command(0x9F); }
-    else 
-      { ssd1306_command(0xCF); }
-    ssd1306_command(SSD1306_SETPRECHARGE);                  // 0xd9
-    if (vccstate == SSD1306_EXTERNALVCC) 
-      { ssd1306_command(0x22); }
-    else 
-      { ssd1306_command(0xF1); }
-    ssd1306_command(SSD1306_SETVCOMDETECT);                 // 0xDB
-    ssd1306_command(0x40);
-    ssd1306_command(SSD1306_DISPLAYALLON_RESUME);           // 0xA4
-    ssd1306_command(SSD1306_NORMALDISPLAY);                 // 0xA6
-  #endif
-  
-  ssd1306_command(SSD1306_DISPLAYON);//--turn on oled panel
+  reinit();
 }
 
+// Send the init sequence, then turn the panel on, in one go.  Unlike
+// begin() there's no reset pulse and the buffer is kept; all of it goes
+// out again on the next display().
+void Adafruit_SSD1306::reinit(void) {
+  const SSD1306_InitSequence *init =
+    (SSD1306_LCDHEIGHT == 64) ? init128x64 : init128x32;
+  if (_vccstate == SSD1306_EXTERNALVCC)
+    init++;
+  ssd1306_commandList(init->bytes, init->len);
+
+  // the panel may have been reset, don't trust what it's showing
+  invalidate();
+}
+
+// Read the I2C status byte: a panel that answers and still has the
+// display on is fine, one that browned out comes back with it off.
+bool Adafruit_SSD1306::probe(void) {
+  if (sid != -1)
+    return true;   // SPI has no status read
+  bool ok;
+  Wire.lock();
+  ok = Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)1) == 1;
+  if (ok)
+    ok = !(Wire.read() & SSD1306_STATUS_DISPLAYOFF);
+  else
+    i2cErrorCount++;
+  Wire.unlock();
+  return ok;
+}
+
+
+void Adafruit_SSD1306::setBusSpeed(uint32_t hz) {
+  busSpeed = hz;
+  busSpeedApplied = false;
+}
+
+void Adafruit_SSD1306::setWireBufferSize(uint16_t bytes) {
+  wireBurst = bytes > 1 ? bytes - 1 : 1;
+}
 
 void Adafruit_SSD1306::invertDisplay(uint8_t i) {
   if (i) {
@@ -283,10 +589,45 @@ void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
   {
     // I2C
     uint8_t control = 0x00;   // Co = 0, D/C = 0
+    Wire.lock();
     Wire.beginTransmission(_i2caddr);
     Wire.write(control);
     Wire.write(c);
-    Wire.endTransmission();
+    if (Wire.endTransmission())
+      i2cErrorCount++;
+    Wire.unlock();
+  }
+}
+
+// Send several command bytes at once.  Over I2C they share one 0x00
+// control byte and go out in as few transactions as the Wire buffer
+// allows, the panel doesn't mind a command's arguments being split.
+void Adafruit_SSD1306::ssd1306_commandList(const uint8_t *c, uint8_t n) {
+  if (sid != -1)
+  {
+    // SPI
+    digitalWrite(cs, HIGH);
+    digitalWrite(dc, LOW);
+    digitalWrite(cs, LOW);
+    while (n--)
+      fastSPIwrite(*c++);
+    digitalWrite(cs, HIGH);
+  }
+  else
+  {
+    // I2C
+    Wire.lock();
+    while (n) {
+      uint8_t chunk = n < wireBurst ? n : wireBurst;
+      Wire.beginTransmission(_i2caddr);
+      Wire.write((uint8_t)0x00);   // Co = 0, D/C = 0
+      Wire.write(c, chunk);
+      if (Wire.endTransmission())
+        i2cErrorCount++;
+      c += chunk;
+      n -= chunk;
+    }
+    Wire.unlock();
   }
 }
 
@@ -295,14 +636,11 @@ void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
 // Hint, the display is 16 rows tall. To scroll the whole display, run:
 // display.scrollright(0x00, 0x0F) 
 void Adafruit_SSD1306::startscrollright(uint8_t start, uint8_t stop){
-	ssd1306_command(SSD1306_RIGHT_HORIZONTAL_SCROLL);
-	ssd1306_command(0X00);
-	ssd1306_command(start);
-	ssd1306_command(0X00);
-	ssd1306_command(stop);
-	ssd1306_command(0X00);
-	ssd1306_command(0XFF);
-	ssd1306_command(SSD1306_ACTIVATE_SCROLL);
+	const uint8_t cmds[] = {
+		SSD1306_RIGHT_HORIZONTAL_SCROLL, 0X00, start, 0X00, stop, 0X00, 0XFF,
+		SSD1306_ACTIVATE_SCROLL
+	};
+	ssd1306_commandList(cmds, sizeof(cmds));
 }
 
 // startscrollleft
@@ -310,14 +648,11 @@ void Adafruit_SSD1306::startscrollright(uint8_t start, uint8_t stop){
 // Hint, the display is 16 rows tall. To scroll the whole display, run:
 // display.scrollright(0x00, 0x0F) 
 void Adafruit_SSD1306::startscrollleft(uint8_t start, uint8_t stop){
-	ssd1306_command(SSD1306_LEFT_HORIZONTAL_SCROLL);
-	ssd1306_command(0X00);
-	ssd1306_command(start);
-	ssd1306_command(0X00);
-	ssd1306_command(stop);
-	ssd1306_command(0X00);
-	ssd1306_command(0XFF);
-	ssd1306_command(SSD1306_ACTIVATE_SCROLL);
+	const uint8_t cmds[] = {
+		SSD1306_LEFT_HORIZONTAL_SCROLL, 0X00, start, 0X00, stop, 0X00, 0XFF,
+		SSD1306_ACTIVATE_SCROLL
+	};
+	ssd1306_commandList(cmds, sizeof(cmds));
 }
 
 // startscrolldiagright
@@ -325,16 +660,12 @@ void Adafruit_SSD1306::startscrollleft(uint8_t start, uint8_t stop){
 // Hint, the display is 16 rows tall. To scroll the whole display, run:
 // display.scrollright(0x00, 0x0F) 
 void Adafruit_SSD1306::startscrolldiagright(uint8_t start, uint8_t stop){
-	ssd1306_command(SSD1306_SET_VERTICAL_SCROLL_AREA);	
-	ssd1306_command(0X00);
-	ssd1306_command(SSD1306_LCDHEIGHT);
-	ssd1306_command(SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL);
-	ssd1306_command(0X00);
-	ssd1306_command(start);
-	ssd1306_command(0X00);
-	ssd1306_command(stop);
-	ssd1306_command(0X01);
-	ssd1306_command(SSD1306_ACTIVATE_SCROLL);
+	const uint8_t cmds[] = {
+		SSD1306_SET_VERTICAL_SCROLL_AREA, 0X00, SSD1306_LCDHEIGHT,
+		SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL, 0X00, start, 0X00, stop, 0X01,
+		SSD1306_ACTIVATE_SCROLL
+	};
+	ssd1306_commandList(cmds, sizeof(cmds));
 }
 
 // startscrolldiagleft
@@ -342,20 +673,18 @@ void Adafruit_SSD1306::startscrolldiagright(uint8_t start, uint8_t stop){
 // Hint, the display is 16 rows tall. To scroll the whole display, run:
 // display.scrollright(0x00, 0x0F) 
 void Adafruit_SSD1306::startscrolldiagleft(uint8_t start, uint8_t stop){
-	ssd1306_command(SSD1306_SET_VERTICAL_SCROLL_AREA);	
-	ssd1306_command(0X00);
-	ssd1306_command(SSD1306_LCDHEIGHT);
-	ssd1306_command(SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL);
-	ssd1306_command(0X00);
-	ssd1306_command(start);
-	ssd1306_command(0X00);
-	ssd1306_command(stop);
-	ssd1306_command(0X01);
-	ssd1306_command(SSD1306_ACTIVATE_SCROLL);
+	const uint8_t cmds[] = {
+		SSD1306_SET_VERTICAL_SCROLL_AREA, 0X00, SSD1306_LCDHEIGHT,
+		SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL, 0X00, start, 0X00, stop, 0X01,
+		SSD1306_ACTIVATE_SCROLL
+	};
+	ssd1306_commandList(cmds, sizeof(cmds));
 }
 
 void Adafruit_SSD1306::stopscroll(void){
 	ssd1306_command(SSD1306_DEACTIVATE_SCROLL);
+	// scrolling moved the panel's RAM around, it has to be rewritten
+	invalidate();
 }
 
 // Dim the display
@@ -375,8 +704,8 @@ void Adafruit_SSD1306::dim(bool dim) {
   }
   // the range of contrast to too small to be really useful
   // it is useful to dim the display
-  ssd1306_command(SSD1306_SETCONTRAST);
-  ssd1306_command(contrast);
+  const uint8_t cmds[] = { SSD1306_SETCONTRAST, contrast };
+  ssd1306_commandList(cmds, sizeof(cmds));
 }
 
 void Adafruit_SSD1306::ssd1306_data(uint8_t c) {
@@ -393,21 +722,160 @@ void Adafruit_SSD1306::ssd1306_data(uint8_t c) {
   {
     // I2C
     uint8_t control = 0x40;   // Co = 0, D/C = 1
+    Wire.lock();
     Wire.beginTransmission(_i2caddr);
     Wire.write(control);
     Wire.write(c);
-    Wire.endTransmission();
+    if (Wire.endTransmission())
+      i2cErrorCount++;
+    Wire.unlock();
   }
 }
 
 void Adafruit_SSD1306::display(void) {
-  ssd1306_command(SSD1306_COLUMNADDR);
-  ssd1306_command(0);   // Column start address (0 = reset)
-  ssd1306_command(127); // Column end address (127 = reset)
+  if (async) {
+    queueFrame();
+    return;
+  }
+  flushBytes = flushWindows(buffer, dirtyLo, dirtyHi);
+}
+
+// Send the dirty windows of src described by lo/hi and mark them clean.
+// Returns the framebuffer bytes sent.
+uint16_t Adafruit_SSD1306::flushWindows(const uint8_t *src, uint8_t *lo, uint8_t *hi) {
+  uint16_t bytes = 0;
+  uint8_t page = 0;
+  while (page < SSD1306_LCDPAGES) {
+    if (lo[page] > hi[page]) {
+      page++;
+      continue;
+    }
+
+    // grow the window over the following dirty pages while the clean
+    // bytes it drags along stay cheap
+    uint8_t first = page, last = page;
+    uint8_t x0 = lo[page], x1 = hi[page];
+    uint16_t used = x1 - x0 + 1;
+    while (last + 1 < SSD1306_LCDPAGES && lo[last + 1] <= hi[last + 1]) {
+      uint8_t n0 = min(x0, lo[last + 1]);
+      uint8_t n1 = max(x1, hi[last + 1]);
+      uint16_t nused = used + hi[last + 1] - lo[last + 1] + 1;
+      if ((uint16_t)(n1 - n0 + 1) * (last - first + 2) - nused > SSD1306_DIRTY_MERGE_SLACK)
+        break;
+      x0 = n0;
+      x1 = n1;
+      used = nused;
+      last++;
+    }
+
+    bytes += sendWindow(src, first, last, x0, x1);
+    for (uint8_t p = first; p <= last; p++) {
+      lo[p] = 0xFF;
+      hi[p] = 0;
+    }
+    page = last + 1;
+  }
+  return bytes;
+}
+
+bool Adafruit_SSD1306::beginAsync(void) {
+  if (async)
+    return true;
+  if (sid != -1)
+    return false;   // the SPI path toggles DC/CS around every command
+
+  pendingFrame = new (std::nothrow) uint8_t[sizeof(buffer)];
+  sendingFrame = new (std::nothrow) uint8_t[sizeof(buffer)];
+  if (!pendingFrame || !sendingFrame ||
+      os_mutex_create(&frameLock) != 0 ||
+      os_semaphore_create(&frameReady, 1, 0) != 0) {
+    delete[] pendingFrame;
+    delete[] sendingFrame;
+    return false;
+  }
+  for (uint8_t p = 0; p < SSD1306_LCDPAGES; p++) {
+    pendingLo[p] = 0xFF;
+    pendingHi[p] = 0;
+  }
+  framePending = false;
+  async = true;
+  flushThread = new Thread("ssd1306", flushLoop, this);
+  return true;
+}
+
+// Hand the current frame to the worker.  The copy is the whole buffer so
+// the sketch can keep drawing; the dirty ranges add up until the worker
+// takes the frame, so a replaced frame's changes still get sent.
+void Adafruit_SSD1306::queueFrame(void) {
+  os_mutex_lock(frameLock);
+  if (framePending)
+    coalesced++;
+  memcpy(pendingFrame, buffer, sizeof(buffer));
+  for (uint8_t p = 0; p < SSD1306_LCDPAGES; p++) {
+    if (dirtyLo[p] < pendingLo[p]) pendingLo[p] = dirtyLo[p];
+    if (dirtyHi[p] > pendingHi[p]) pendingHi[p] = dirtyHi[p];
+    dirtyLo[p] = 0xFF;
+    dirtyHi[p] = 0;
+  }
+  framePending = true;
+  flushBusy.store(true, std::memory_order_release);
+  os_mutex_unlock(frameLock);
+  os_semaphore_give(frameReady, false);
+}
+
+os_thread_return_t Adafruit_SSD1306::flushLoop(void *arg) {
+  Adafruit_SSD1306 *self = (Adafruit_SSD1306 *)arg;
+  for (;;) {
+    os_semaphore_take(self->frameReady, CONCURRENT_WAIT_FOREVER, false);
+    for (;;) {
+      os_mutex_lock(self->frameLock);
+      if (!self->framePending) {
+        self->flushBusy.store(false, std::memory_order_release);
+        os_mutex_unlock(self->frameLock);
+        break;
+      }
+      uint8_t *frame = self->pendingFrame;
+      self->pendingFrame = self->sendingFrame;
+      self->sendingFrame = frame;
+      for (uint8_t p = 0; p < SSD1306_LCDPAGES; p++) {
+        self->sendingLo[p] = self->pendingLo[p];
+        self->sendingHi[p] = self->pendingHi[p];
+        self->pendingLo[p] = 0xFF;
+        self->pendingHi[p] = 0;
+      }
+      self->framePending = false;
+      os_mutex_unlock(self->frameLock);
+
+      self->flushBytes = self->flushWindows(frame, self->sendingLo, self->sendingHi);
+    }
+  }
+}
+
+bool Adafruit_SSD1306::awaitFlush(uint32_t timeout) {
+  uint32_t start = millis();
+  while (!flushDone()) {
+    if (millis() - start >= timeout)
+      return false;
+    delay(1);
+  }
+  return true;
+}
 
-  ssd1306_command(SSD1306_PAGEADDR);
-  ssd1306_command(0); // Page start address (0 = reset)
-  ssd1306_command((SSD1306_LCDHEIGHT == 64) ? 7 : 3); // Page end address
+// Send columns x0..x1 of pages page0..page1.  With horizontal addressing
+// the panel wraps to the next page at the end of the column window, so the
+// bytes go out row by row.
+uint16_t Adafruit_SSD1306::sendWindow(const uint8_t *src, uint8_t page0, uint8_t page1,
+                                      uint8_t x0, uint8_t x1) {
+  // keep the window's commands and data together when the worker thread
+  // shares the bus with the sketch (Wire's lock is recursive)
+  if (sid == -1)
+    Wire.lock();
+
+  const uint8_t window[] = {
+    SSD1306_COLUMNADDR, x0, x1,       // Column start and end address
+    SSD1306_PAGEADDR, page0, page1    // Page start and end address
+  };
+  ssd1306_commandList(window, sizeof(window));
 
   if (sid != -1)
   {
@@ -417,35 +885,58 @@ void Adafruit_SSD1306::display(void) {
     digitalWrite(cs, LOW);
 	delayMicroseconds(1);		// May not be necessary - needs testing
 
-    for (uint16_t i=0; i<(SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8); i++) {
-      fastSPIwrite(buffer[i]);
-      //ssd1306_data(buffer[i]);
+    for (uint8_t p = page0; p <= page1; p++) {
+      const uint8_t *row = src + p * SSD1306_LCDWIDTH;
+      for (uint8_t x = x0; x <= x1; x++) {
+        fastSPIwrite(row[x]);
+      }
     }
 	delayMicroseconds(1);		// May not be necessary - needs testing
     digitalWrite(cs, HIGH);
   }
   else
   {
-    // I2C
-    for (uint16_t i=0; i<(SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8); i++) {
-      // send a bunch of data in one xmission
-      Wire.beginTransmission(_i2caddr);
-      Wire.write(0x40);
-      for (uint8_t x=0; x<16; x++) {
-		Wire.write(buffer[i]);
-		i++;
-		}
-	i--;
-	Wire.endTransmission();
-	}
+    // I2C.  Fill each transaction to the Wire buffer; the panel wraps at
+    // the end of the window, so a transaction can span pages.
+    uint8_t w = x1 - x0 + 1;
+    uint16_t room = 0;
+    for (uint8_t p = page0; p <= page1; p++) {
+      const uint8_t *row = src + p * SSD1306_LCDWIDTH + x0;
+      uint8_t left = w;
+      while (left) {
+        if (room == 0) {
+          Wire.beginTransmission(_i2caddr);
+          Wire.write(0x40);
+          room = wireBurst;
+        }
+        uint8_t n = left < room ? left : room;
+        Wire.write(row, n);
+        row += n;
+        left -= n;
+        room -= n;
+        if (room == 0 && Wire.endTransmission())
+          i2cErrorCount++;
+      }
+    }
+    if (room && Wire.endTransmission())
+      i2cErrorCount++;
+    Wire.unlock();
   }
+  return (uint16_t)(x1 - x0 + 1) * (page1 - page0 + 1);
 }
 
 // clear everything
 void Adafruit_SSD1306::clearDisplay(void) {
   memset(buffer, 0, (SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8));
+  invalidate();
 }
 
+void Adafruit_SSD1306::invalidate(void) {
+  for (uint8_t p = 0; p < SSD1306_LCDPAGES; p++) {
+    dirtyLo[p] = 0;
+    dirtyHi[p] = SSD1306_LCDWIDTH - 1;
+  }
+}
 
 inline void Adafruit_SSD1306::fastSPIwrite(uint8_t d) {
   
@@ -502,12 +993,14 @@ void Adafruit_SSD1306::drawFastHLineInternal(int16_t x, int16_t y, int16_t w, ui
 
   // make sure we don't go off the edge of the display
   if( (x + w) > WIDTH) { 
-    w = (HEIGHT- x);
+    w = (WIDTH - x);
   }
 
   // if our width is now negative, punt
   if(w <= 0) { return; }
 
+  markDirty(y/8, x, x + w - 1);
+
   // set up the pointer for  movement through the buffer
   register uint8_t *pBuf = buffer;
   // adjust the buffer pointer for the current row
@@ -586,6 +1079,10 @@ void Adafruit_SSD1306::drawFastVLineInternal(int16_t x, int16_t __y, int16_t __h
   register uint8_t y = __y;
   register uint8_t h = __h;
 
+  for (uint8_t page = y/8; page <= (y + h - 1)/8; page++) {
+    markDirty(page, x, x);
+  }
+
 
   // set up the pointer for fast movement through the buffer
   register uint8_t *pBuf = buffer;
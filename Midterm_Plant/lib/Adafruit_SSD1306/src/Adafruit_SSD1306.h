@@ -16,7 +16,10 @@ BSD license, check license.txt for more information
 All text above, and the splash screen must be included in any redistribution
 *********************************************************************/
 
+#ifndef _ADAFRUIT_SSD1306_H
+#define _ADAFRUIT_SSD1306_H
 
+#include <atomic>
 #include "application.h"
 #include "Adafruit_GFX.h"
 
@@ -87,6 +90,38 @@ All text above, and the splash screen must be included in any redistribution
 #define SSD1306_COLUMNADDR 0x21
 #define SSD1306_PAGEADDR   0x22
 
+#define SSD1306_LCDPAGES (SSD1306_LCDHEIGHT / 8)
+
+// display() merges neighbouring dirty pages into one window when that
+// resends at most this many clean bytes; cheaper than another set of
+// COLUMNADDR/PAGEADDR commands.
+#define SSD1306_DIRTY_MERGE_SLACK 24
+
+// Largest text size drawn a byte column at a time; the cell of a bigger
+// character spans more pages than the blitter handles.
+#define SSD1306_BLIT_MAXSIZE 4
+
+// Wire transmit buffer the driver assumes, Device OS's default.  Each I2C
+// transaction carries one control byte and up to this size - 1 data bytes.
+#define SSD1306_WIRE_BUFFER 32
+// Buffer size that lets a whole frame go out in one transaction, for an
+// application's acquireWireBuffer():
+//
+//   hal_i2c_config_t acquireWireBuffer() {
+//     hal_i2c_config_t config = {
+//       .size = sizeof(hal_i2c_config_t),
+//       .version = HAL_I2C_CONFIG_VERSION_1,
+//       .rx_buffer = new (std::nothrow) uint8_t[32],
+//       .rx_buffer_size = 32,
+//       .tx_buffer = new (std::nothrow) uint8_t[SSD1306_WIRE_FRAME_BUFFER],
+//       .tx_buffer_size = SSD1306_WIRE_FRAME_BUFFER
+//     };
+//     return config;
+//   }
+//   ...
+//   display.setWireBufferSize(SSD1306_WIRE_FRAME_BUFFER);
+#define SSD1306_WIRE_FRAME_BUFFER (SSD1306_LCDWIDTH * SSD1306_LCDHEIGHT / 8 + 1)
+
 #define SSD1306_COMSCANINC 0xC0
 #define SSD1306_COMSCANDEC 0xC8
 
@@ -94,6 +129,9 @@ All text above, and the splash screen must be included in any redistribution
 
 #define SSD1306_CHARGEPUMP 0x8D
 
+// status byte read over I2C
+#define SSD1306_STATUS_DISPLAYOFF 0x40
+
 #define SSD1306_EXTERNALVCC 0x1
 #define SSD1306_SWITCHCAPVCC 0x2
 
@@ -113,12 +151,47 @@ class Adafruit_SSD1306 : public Adafruit_GFX {
   Adafruit_SSD1306(int8_t RST);
 
   void begin(uint8_t switchvcc = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = SSD1306_I2C_ADDRESS);
+  // I2C clock in Hz (100000, 400000, 1000000 for Fm+ where the platform
+  // and pull-ups allow it), applied by begin().  The bus is shared, so
+  // this sets it for every device on Wire.  0 leaves the bus alone.
+  void setBusSpeed(uint32_t hz);
+  // Size of the Wire transmit buffer, if the application enlarged it with
+  // acquireWireBuffer().  Larger buffers mean fewer, longer transactions.
+  void setWireBufferSize(uint16_t bytes);
+  // Bring the controller back after a glitch or brown-out without the
+  // reset pulse and delays of begin(); the buffer is kept and resent.
+  void reinit(void);
+  // True if the panel answers over I2C and is still switched on.
+  bool probe(void);
+  // I2C transfers that failed (NACK, bus error or timeout) since power up.
+  uint32_t i2cErrors(void) { return i2cErrorCount.load(std::memory_order_relaxed); }
   void ssd1306_command(uint8_t c);
+  // Several command bytes in one transaction, e.g. a command and its arguments.
+  void ssd1306_commandList(const uint8_t *c, uint8_t n);
   void ssd1306_data(uint8_t c);
 
   void clearDisplay(void);
   void invertDisplay(uint8_t i);
+  // Send the parts of the buffer that changed since the last call.
   void display();
+  // Make the next display() send the whole buffer, e.g. after the panel
+  // lost its contents.
+  void invalidate(void);
+  // Framebuffer bytes sent by the last display().
+  uint16_t lastFlushBytes(void) { return flushBytes; }
+
+  // Asynchronous mode, I2C only.  Call after begin().  From then on
+  // display() copies the frame and returns; a worker thread sends it while
+  // the sketch carries on drawing.  If the sketch calls display() again
+  // before the last frame went out, the newer frame replaces it.  Takes
+  // 2 KB for the extra frames.  Returns false if it couldn't start.
+  bool beginAsync(void);
+  // True once every frame handed to display() is on the panel.
+  bool flushDone(void) { return !flushBusy.load(std::memory_order_acquire); }
+  // Wait up to timeout ms for flushDone().
+  bool awaitFlush(uint32_t timeout);
+  // Frames replaced by a newer one before they were sent.
+  uint32_t framesCoalesced(void) { return coalesced; }
 
   void startscrollright(uint8_t start, uint8_t stop);
   void startscrollleft(uint8_t start, uint8_t stop);
@@ -133,6 +206,11 @@ class Adafruit_SSD1306 : public Adafruit_GFX {
 
   virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
   virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  virtual void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                        uint16_t bg, uint8_t size);
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void fillScreen(uint16_t color);
 
  private:
   int8_t _i2caddr, _vccstate, sid, sclk, dc, rst, cs;
@@ -140,8 +218,38 @@ class Adafruit_SSD1306 : public Adafruit_GFX {
 
   boolean hwSPI;
 
+  uint32_t busSpeed;
+  bool busSpeedApplied;
+  uint16_t wireBurst;   // data bytes per I2C transaction
+  std::atomic<uint32_t> i2cErrorCount;   // bumped by the flush thread too
+
+  // per page, the range of columns changed since the last display();
+  // dirtyLo > dirtyHi means the page is clean
+  uint8_t dirtyLo[SSD1306_LCDPAGES], dirtyHi[SSD1306_LCDPAGES];
+  uint16_t flushBytes;
+  inline void markDirty(uint8_t page, uint8_t x0, uint8_t x1) __attribute__((always_inline));
+  void markRect(int16_t x, int16_t y, int16_t w, int16_t h);
+  uint16_t flushWindows(const uint8_t *src, uint8_t *lo, uint8_t *hi);
+  uint16_t sendWindow(const uint8_t *src, uint8_t page0, uint8_t page1, uint8_t x0, uint8_t x1);
+
+  // asynchronous flush: display() copies the frame into pendingFrame, the
+  // worker swaps it with sendingFrame under frameLock and sends from there
+  bool async;
+  uint8_t *pendingFrame, *sendingFrame;
+  uint8_t pendingLo[SSD1306_LCDPAGES], pendingHi[SSD1306_LCDPAGES];
+  uint8_t sendingLo[SSD1306_LCDPAGES], sendingHi[SSD1306_LCDPAGES];
+  bool framePending;
+  std::atomic<bool> flushBusy;
+  uint32_t coalesced;
+  os_mutex_t frameLock;
+  os_semaphore_t frameReady;
+  Thread *flushThread;
+  void queueFrame(void);
+  static os_thread_return_t flushLoop(void *arg);
+
   inline void drawFastVLineInternal(int16_t x, int16_t y, int16_t h, uint16_t color) __attribute__((always_inline));
   inline void drawFastHLineInternal(int16_t x, int16_t y, int16_t w, uint16_t color) __attribute__((always_inline));
 
 };
 
+#endif // _ADAFRUIT_SSD1306_H
@@ -0,0 +1,134 @@
+#include "Adafruit_SSD1306_Field.h"
+
+Adafruit_SSD1306_Field::Adafruit_SSD1306_Field(Adafruit_SSD1306 &display, int16_t x, int16_t y,
+                                               uint8_t width, const char *label, uint8_t size,
+                                               uint16_t color, uint16_t bg) :
+  display(display), x(x), y(y), width(width), size(size), color(color), bg(bg),
+  label(label) {
+  if (this->width > SSD1306_FIELD_MAXCHARS)
+    this->width = SSD1306_FIELD_MAXCHARS;
+  labelLen = strnlen(label, this->width);
+  redraw();
+}
+
+void Adafruit_SSD1306_Field::redraw() {
+  memset(shown, 0, sizeof(shown));
+}
+
+// The label, then whatever the caller puts, then blanks to the width.
+void Adafruit_SSD1306_Field::start() {
+  cursor = 0;
+  drawn = 0;
+  for (uint8_t i=0; i<labelLen; i++)
+    put(label[i]);
+}
+
+void Adafruit_SSD1306_Field::put(char c) {
+  if (cursor >= width)
+    return;
+  if (c != shown[cursor]) {
+    // the class is known, skip the virtual call
+    display.Adafruit_SSD1306::drawChar(x + cursor * 6 * size, y, c, color, bg, size);
+    shown[cursor] = c;
+    drawn++;
+  }
+  cursor++;
+}
+
+void Adafruit_SSD1306_Field::putString(const char *s) {
+  while (*s)
+    put(*s++);
+}
+
+// value in decimal, zero padded to minDigits
+void Adafruit_SSD1306_Field::putDigits(uint32_t value, uint8_t minDigits) {
+  char digits[10];
+  uint8_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (n < sizeof(digits) && (value || n < minDigits));
+  while (n)
+    put(digits[--n]);
+}
+
+uint8_t Adafruit_SSD1306_Field::finish() {
+  while (cursor < width)
+    put(' ');
+  return drawn;
+}
+
+uint8_t Adafruit_SSD1306_Field::set(const char *value) {
+  start();
+  putString(value);
+  return finish();
+}
+
+uint8_t Adafruit_SSD1306_Field::setInt(int32_t value, const char *suffix) {
+  start();
+  uint32_t magnitude = value;
+  if (value < 0) {
+    put('-');
+    magnitude = -magnitude;
+  }
+  putDigits(magnitude, 1);
+  putString(suffix);
+  return finish();
+}
+
+uint8_t Adafruit_SSD1306_Field::setFixed(float value, uint8_t decimals, const char *suffix) {
+  static const uint16_t scales[SSD1306_FIELD_MAXDECIMALS + 1] = {1, 10, 100, 1000, 10000};
+  if (decimals > SSD1306_FIELD_MAXDECIMALS)
+    decimals = SSD1306_FIELD_MAXDECIMALS;
+  uint32_t scale = scales[decimals];
+
+  // a float times at most 10^4 is exact in a double, so this rounds the
+  // value actually stored, ties to even, the same as printf
+  double exact = value;
+  bool negative = exact < 0;
+  if (negative)
+    exact = -exact;
+  exact *= scale;
+  // also catches NaN
+  if (!(exact < 4294967295.0)) {
+    start();
+    putString("--");
+    putString(suffix);
+    return finish();
+  }
+  uint32_t scaled = exact;
+  double fraction = exact - scaled;
+  if (fraction > 0.5 || (fraction == 0.5 && (scaled & 1)))
+    scaled++;
+
+  start();
+  // no "-0.0" for a value that rounds to zero
+  if (negative && scaled)
+    put('-');
+  putDigits(scaled / scale, 1);
+  if (decimals) {
+    put('.');
+    putDigits(scaled % scale, decimals);
+  }
+  putString(suffix);
+  return finish();
+}
+
+uint8_t Adafruit_SSD1306_Field::setTime(uint8_t hour, uint8_t minute, uint8_t second) {
+  start();
+  putDigits(hour, 2);
+  put(':');
+  putDigits(minute, 2);
+  put(':');
+  putDigits(second, 2);
+  return finish();
+}
+
+uint8_t Adafruit_SSD1306_Field::printf(const char *format, ...) {
+  char value[SSD1306_FIELD_MAXCHARS + 1];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(value, sizeof(value), format, args);
+  va_end(args);
+  return set(value);
+}
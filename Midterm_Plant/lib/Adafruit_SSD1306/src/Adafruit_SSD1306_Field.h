@@ -0,0 +1,76 @@
+// Retained-mode text field.
+//
+// A field is one line of text at a fixed place on the display: a constant
+// label followed by a value.  It remembers the characters it last drew, and
+// set() redraws only the cells whose character changed, each one opaque so
+// nothing has to be cleared first.  drawChar marks just those cells dirty,
+// so a reading that went from 71.3 to 71.4 sends one character's worth of
+// bytes on the next display().
+//
+//   Adafruit_SSD1306_Field temp(display, 0, 20, 21, "Temp ");
+//   ...
+//   temp.printf("%0.1fF", tempF);
+//   display.display();
+//
+// setInt, setFixed and setTime put their digits straight into the cells,
+// with no vsnprintf and no trip through Print and GFX's write(), so use
+// them for the numbers that change every refresh.
+//
+// Anything that draws over a field behind its back (clearDisplay, a full
+// screen message) must be followed by redraw() on the fields it covered.
+#ifndef _ADAFRUIT_SSD1306_FIELD_H
+#define _ADAFRUIT_SSD1306_FIELD_H
+
+#include "Adafruit_SSD1306.h"
+
+// A full line of size 1 text on a 128 pixel wide panel.
+#define SSD1306_FIELD_MAXCHARS (SSD1306_LCDWIDTH / 6)
+
+#define SSD1306_FIELD_MAXDECIMALS 4
+
+class Adafruit_SSD1306_Field {
+ public:
+  // width is in characters, label and value together; the label must
+  // outlive the field.
+  Adafruit_SSD1306_Field(Adafruit_SSD1306 &display, int16_t x, int16_t y,
+                         uint8_t width, const char *label = "", uint8_t size = 1,
+                         uint16_t color = WHITE, uint16_t bg = BLACK);
+
+  // Show label + value, padded with blanks or cut to the width.  Returns
+  // the number of cells that were drawn.
+  uint8_t set(const char *value);
+  uint8_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  // Numbers without a format string.  The suffix follows the number, e.g.
+  // setFixed(tempF, 1, "\xF8" "F") for "71.4" plus a degree sign and F.
+  uint8_t setInt(int32_t value, const char *suffix = "");
+  // value rounded to decimals places (at most SSD1306_FIELD_MAXDECIMALS)
+  // the way printf("%.*f") rounds it.  NaN, infinities and anything that
+  // doesn't fit in a uint32_t once scaled show as "--".
+  uint8_t setFixed(float value, uint8_t decimals, const char *suffix = "");
+  // hh:mm:ss
+  uint8_t setTime(uint8_t hour, uint8_t minute, uint8_t second);
+
+  // Forget what's on screen, the next set() draws every cell.
+  void redraw();
+
+ private:
+  Adafruit_SSD1306 &display;
+  int16_t x, y;
+  uint8_t width, size;
+  uint16_t color, bg;
+  const char *label;
+  uint8_t labelLen;
+  // 0 never gets drawn, so it marks a cell as unknown
+  char shown[SSD1306_FIELD_MAXCHARS];
+  // the cell the next character goes in, and how many were drawn this time
+  uint8_t cursor, drawn;
+
+  void start();
+  void put(char c);
+  void putString(const char *s);
+  void putDigits(uint32_t value, uint8_t minDigits);
+  uint8_t finish();
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef _I2CBUS_H_
+#define _I2CBUS_H_
+
+/*
+ *  Project: I2C bus supervisor
+ *  Description: Watches the devices sharing an I2C bus, frees the bus when
+ *               a device holds SDA low and brings back only the device
+ *               that faulted.  Each device brings three small functions:
+ *               its running count of failed transfers, a probe that says
+ *               it's there and configured, and a recover that fixes it
+ *               without a full begin().
+ *
+ *    I2CBus bus(Wire, SDA, SCL);
+ *    bus.addDevice(oledErrors, oledProbe, oledRecover);
+ *    ...
+ *    bus.check();        // every pass of loop()
+ *    bus.check(true);    // probe everything now, e.g. after the pump stops
+ */
+
+#include "application.h"
+
+const int I2CBUS_MAXDEVICES = 4;
+
+typedef uint32_t (*I2CBusErrorsFn)();   // failed transfers so far
+typedef bool (*I2CBusProbeFn)();        // true if the device is fine
+typedef bool (*I2CBusRecoverFn)();      // true if the device came back
+
+class I2CBus {
+
+  struct Device {
+    I2CBusErrorsFn errors;
+    I2CBusProbeFn probe;
+    I2CBusRecoverFn recover;
+    uint32_t seenErrors;
+    uint32_t faults;
+    uint32_t recoveries;
+  };
+
+  TwoWire &_wire;
+  int _sda, _scl;
+  Device _devices[I2CBUS_MAXDEVICES];
+  int _deviceCount;
+  unsigned int _probeInterval, _lastProbe;
+  uint32_t _busClears;
+
+  public:
+    I2CBus(TwoWire &wire, int sda, int scl, unsigned int probeMsec=5000) : _wire(wire) {
+      _sda = sda;
+      _scl = scl;
+      _deviceCount = 0;
+      _probeInterval = probeMsec;
+      _lastProbe = 0;
+      _busClears = 0;
+    }
+
+    // Returns the device's index for the counters, -1 if the table is full.
+    int addDevice(I2CBusErrorsFn errors, I2CBusProbeFn probe, I2CBusRecoverFn recover) {
+      if (_deviceCount >= I2CBUS_MAXDEVICES) {
+        return -1;
+      }
+      Device &d = _devices[_deviceCount];
+      d.errors = errors;
+      d.probe = probe;
+      d.recover = recover;
+      d.seenErrors = errors();
+      d.faults = 0;
+      d.recoveries = 0;
+      return _deviceCount++;
+    }
+
+    // A device has faulted when its error count moved since the last check,
+    // or when its probe fails.  Probes run every probeMsec, or now with
+    // probeNow.  Returns the number of devices that faulted.
+    int check(bool probeNow=false) {
+      bool probing = probeNow || (millis() - _lastProbe) >= _probeInterval;
+      if (probing) {
+        _lastProbe = millis();
+      }
+
+      bool faulted[I2CBUS_MAXDEVICES];
+      int count = 0;
+      for (int i=0; i<_deviceCount; i++) {
+        Device &d = _devices[i];
+        faulted[i] = d.errors() != d.seenErrors || (probing && !d.probe());
+        if (faulted[i]) {
+          count++;
+        }
+      }
+      if (count == 0) {
+        return 0;
+      }
+
+      // a device that lost track mid-byte can hold SDA low for everyone
+      clearBus();
+
+      for (int i=0; i<_deviceCount; i++) {
+        Device &d = _devices[i];
+        if (faulted[i]) {
+          d.faults++;
+          if (d.recover()) {
+            d.recoveries++;
+          }
+        }
+        // the probe and recovery errors are part of this fault
+        d.seenErrors = d.errors();
+      }
+      return count;
+    }
+
+    // Free the bus if a device is holding SDA low: with Wire off, clock SCL
+    // until it lets go (9 clocks finish any byte it was sending), then
+    // make a STOP.  Returns true if the bus is free afterwards.
+    bool clearBus() {
+      bool free;
+      WITH_LOCK(_wire) {
+        _wire.end();
+        pinMode(_sda, INPUT_PULLUP);
+        pinMode(_scl, INPUT_PULLUP);
+        free = digitalRead(_sda) && digitalRead(_scl);
+        if (!free) {
+          _busClears++;
+          pinMode(_scl, OUTPUT_OPEN_DRAIN);
+          for (int i=0; i<9 && !digitalRead(_sda); i++) {
+            digitalWrite(_scl, LOW);
+            delayMicroseconds(5);
+            digitalWrite(_scl, HIGH);
+            delayMicroseconds(5);
+          }
+          // STOP: SDA goes high while SCL is high
+          pinMode(_sda, OUTPUT_OPEN_DRAIN);
+          digitalWrite(_scl, LOW);
+          digitalWrite(_sda, LOW);
+          delayMicroseconds(5);
+          digitalWrite(_scl, HIGH);
+          delayMicroseconds(5);
+          digitalWrite(_sda, HIGH);
+          delayMicroseconds(5);
+          pinMode(_sda, INPUT_PULLUP);
+          pinMode(_scl, INPUT_PULLUP);
+          free = digitalRead(_sda) && digitalRead(_scl);
+        }
+        _wire.begin();
+      }
+      return free;
+    }
+
+    // bus clears that had to clock a stuck device free
+    uint32_t busClears() {
+      return _busClears;
+    }
+
+    uint32_t errors(int dev) {
+      return _devices[dev].errors();
+    }
+
+    uint32_t faults(int dev) {
+      return _devices[dev].faults;
+    }
+
+    uint32_t recoveries(int dev) {
+      return _devices[dev].recoveries;
+    }
+};
+
+#endif // _I2CBUS_H_
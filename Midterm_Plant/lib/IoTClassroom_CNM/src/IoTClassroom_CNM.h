@@ -2,4 +2,5 @@
 #include "hue.h"
 #include "wemo.h"
 #include "IoTTimer.h"
-#include "Button.h"
\ No newline at end of file
+#include "Button.h"
+#include "I2CBus.h"
\ No newline at end of file
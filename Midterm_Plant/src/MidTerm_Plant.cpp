@@ -8,12 +8,20 @@
 #include "Adafruit_BME280.h"
 #include "Adafruit_GFX.h"
 #include "Adafruit_SSD1306.h"
+#include "Adafruit_SSD1306_Field.h"
 #include "credentials.h"
 #include <Adafruit_MQTT.h>
 #include "Adafruit_MQTT/Adafruit_MQTT_SPARK.h"
 #include "Adafruit_MQTT/Adafruit_MQTT.h"
+#include "Adafruit_MQTT_PublishPolicy.h"
+#include "Adafruit_MQTT_Router.h"
+#include "Adafruit_MQTT_Log.h"
+#include "log-events.h"
+#include "Adafruit_MQTT_Latency.h"
+#include "Adafruit_MQTT_Typed.h"
 #include "Air_Quality_Sensor.h"
 #include "IoTTimer.h"
+#include "I2CBus.h"
 
 //system setup
 SYSTEM_MODE(AUTOMATIC);
@@ -32,6 +40,28 @@ const int WATERABOVE = 2400;
 //display
 Adafruit_SSD1306 display(OLED_RESET);
 
+//dashboard lines, each one only redraws the characters that changed
+Adafruit_SSD1306_Field timeField(display,0,0,21,"Time: ");
+Adafruit_SSD1306_Field airField(display,0,10,21,"Air Quality ");
+Adafruit_SSD1306_Field tempField(display,0,20,21,"Temp ");
+Adafruit_SSD1306_Field humidField(display,0,30,21,"Humid ");
+Adafruit_SSD1306_Field moistField(display,0,40,21,"Moisture ");
+Adafruit_SSD1306_Field dustField(display,0,50,21,"Dust ");
+Adafruit_SSD1306_Field *const dashboard[] = {&timeField,&airField,&tempField,&humidField,&moistField,&dustField};
+
+//big enough Wire transmit buffer for a whole display frame in one transaction
+hal_i2c_config_t acquireWireBuffer() {
+  hal_i2c_config_t config = {
+    .size = sizeof(hal_i2c_config_t),
+    .version = HAL_I2C_CONFIG_VERSION_1,
+    .rx_buffer = new (std::nothrow) uint8_t[32],
+    .rx_buffer_size = 32,
+    .tx_buffer = new (std::nothrow) uint8_t[SSD1306_WIRE_FRAME_BUFFER],
+    .tx_buffer_size = SSD1306_WIRE_FRAME_BUFFER
+  };
+  return config;
+}
+
 //for moisture sensor
 int moistRead = 0;
 
@@ -39,9 +69,6 @@ int moistRead = 0;
 bool butPushed = false;
 bool butUp=true;
 
-//time syncing
-String DateTime , TimeOnly ;
-
 //bme 280 code (temp, pressure, humidity)
 Adafruit_BME280 bme;
 bool status;
@@ -52,18 +79,47 @@ float humidRH;
 //adafruit for publishing/subscribing
 TCPClient TheClient; 
 Adafruit_MQTT_SPARK mqtt(&TheClient,AIO_SERVER,AIO_SERVERPORT,AIO_USERNAME,AIO_KEY); 
-Adafruit_MQTT_Subscribe subFeed = Adafruit_MQTT_Subscribe(&mqtt, AIO_USERNAME "/feeds/turnonpump"); 
 
-Adafruit_MQTT_Publish humidFeed = Adafruit_MQTT_Publish(&mqtt, AIO_USERNAME "/feeds/planthumid");
-Adafruit_MQTT_Publish tempFeed = Adafruit_MQTT_Publish(&mqtt, AIO_USERNAME "/feeds/planttemp");
-Adafruit_MQTT_Publish airFeed = Adafruit_MQTT_Publish(&mqtt, AIO_USERNAME "/feeds/plantair");
-Adafruit_MQTT_Publish moisFeed = Adafruit_MQTT_Publish(&mqtt, AIO_USERNAME "/feeds/plantmois");
-Adafruit_MQTT_Publish dustFeed = Adafruit_MQTT_Publish(&mqtt, AIO_USERNAME "/feeds/plantdust");
+//optional local broker in the greenhouse (e.g. mosquitto) for local control:
+//#define EDGE_SERVER "192.168.1.10" in credentials.h to use one
+#ifdef EDGE_SERVER
+#ifndef EDGE_SERVERPORT
+#define EDGE_SERVERPORT 1883
+#endif
+TCPClient EdgeClient;
+Adafruit_MQTT_SPARK edge(&EdgeClient,EDGE_SERVER,EDGE_SERVERPORT);
+Adafruit_MQTT_Router router(&edge,&mqtt);
+#else
+Adafruit_MQTT_Router router(NULL,&mqtt);
+#endif
+Adafruit_MQTT_TypedSubscribe<bool> subFeed(&mqtt, AIO_USERNAME "/feeds/turnonpump"); 
+Adafruit_MQTT_Subscribe throttleFeed = Adafruit_MQTT_Subscribe(&mqtt, AIO_USERNAME "/throttle");
+
+Adafruit_MQTT_Publish humidFeed = Adafruit_MQTT_Publish(&router, AIO_USERNAME "/feeds/planthumid");
+Adafruit_MQTT_Publish tempFeed = Adafruit_MQTT_Publish(&router, AIO_USERNAME "/feeds/planttemp");
+Adafruit_MQTT_Publish airFeed = Adafruit_MQTT_Publish(&router, AIO_USERNAME "/feeds/plantair");
+Adafruit_MQTT_Publish moisFeed = Adafruit_MQTT_Publish(&router, AIO_USERNAME "/feeds/plantmois");
+Adafruit_MQTT_Publish dustFeed = Adafruit_MQTT_Publish(&router, AIO_USERNAME "/feeds/plantdust");
+
+//publish policies: check every sample, send only on real change (or every 10 minutes)
+const int PUBMIN = 15000;
+const int PUBMAX = 600000;
+Adafruit_MQTT_PublishPolicy humidPolicy(&humidFeed,PUBMIN,PUBMAX);
+Adafruit_MQTT_PublishPolicy tempPolicy(&tempFeed,PUBMIN,PUBMAX);
+Adafruit_MQTT_PublishPolicy airPolicy(&airFeed,PUBMIN,PUBMAX);
+Adafruit_MQTT_PublishPolicy moisPolicy(&moisFeed,PUBMIN,PUBMAX);
+Adafruit_MQTT_PublishPolicy dustPolicy(&dustFeed,PUBMIN,PUBMAX);
 
 //pump
 int pumpOnOff;
 bool bolCheckWater = false;
 
+//web pump command latency, receipt to digitalWrite (and the part spent waiting to be dispatched);
+//receipt is the last time the socket was seen empty before the command, so stage waits count
+const int PUMP_SLO_US = 20000;
+Adafruit_MQTT_Latency pumpLatency(PUMP_SLO_US);
+Adafruit_MQTT_Latency pumpDispatchLatency;
+
 //dust sensor
 unsigned int duration,startTime,lowpulseoccupancy;
 float ratio,concentration;
@@ -77,12 +133,22 @@ int quality;
 //get all the timers prepared
 IoTTimer timerOneSec;
 IoTTimer timerFifSec;
-IoTTimer timerTwoMin;
 IoTTimer timerThirtyMin;
 IoTTimer timerStopWater;
 bool bolFirst = true;
 bool pushNow = false;
 
+//the display and the BME 280 share the I2C bus, and pump noise can upset either one
+I2CBus i2cBus(Wire,SDA,SCL);
+uint32_t displayErrors() {return display.i2cErrors();}
+bool displayProbe() {return display.probe();}
+bool displayRecover() {display.reinit(); display.display(); return display.probe();}
+uint32_t bmeErrors() {return bme.i2cErrors();}
+bool bmeProbe() {bool ok=false; WITH_LOCK(Wire) {ok=bme.probe();} return ok;}
+bool bmeRecover() {bool ok=false; WITH_LOCK(Wire) {ok=bme.recover();} return ok;}
+int displayDev, bmeDev;
+
+
 //all the test functions
 // void testPump();
 // void testDisplay();
@@ -94,8 +160,8 @@ bool pushNow = false;
 //the production functions
 void mainProgram();
 float getDustNumber();
-void MQTT_connect();
-bool MQTT_ping();
+void checkPump(int timeout);
+void checkI2C(bool probeNow);
 
 //setup everything here
 void setup() {
@@ -115,34 +181,74 @@ void setup() {
 
   //start the BME 280
   status=bme.begin (0x76);
-  if (status==false ) {Serial.printf ("BME280 at address %c failed to start ", 0x76 );}
+  if (status==false ) {mqttLog.log(LOG_BME_FAILED,0x76);}
+
+  //sensor feeds are bulk telemetry, pump acks and pings always go first
+  humidFeed.setPriority(MQTT_PRIO_BULK);
+  tempFeed.setPriority(MQTT_PRIO_BULK);
+  airFeed.setPriority(MQTT_PRIO_BULK);
+  moisFeed.setPriority(MQTT_PRIO_BULK);
+  dustFeed.setPriority(MQTT_PRIO_BULK);
+
+  //deadbands for the publish policies (air quality publishes on any change)
+  humidPolicy.setDeadband(1.0);        // %RH
+  tempPolicy.setDeadband(0.5);         // deg F
+  moisPolicy.setDeadband(50);          // raw counts
+  moisPolicy.setRateTrigger(2);        // counts per second, 30 a sample: a fast drop goes out before the deadband
+  dustPolicy.setDeadband(0.10,true);   // 10 percent
+
+  //feeds go to both brokers: local for the pump button and dashboards, cloud for history
+  //anything else (the throttle topic) stays on the cloud
+#ifdef EDGE_SERVER
+  router.addRule(AIO_USERNAME "/feeds/",MQTT_ROUTE_BOTH);
+#endif
 
   //start the read ubscription for the online button
-  mqtt.subscribe(&subFeed);
+  router.subscribe(&subFeed);
+
+  //stay under the Adafruit IO free account limit (30 a minute) and back off when throttled
+  mqtt.setRateLimit(30,5);
+  mqtt.subscribe(&throttleFeed);
+  mqtt.setThrottleFeed(&throttleFeed);
 
   //dust sensor
   pinMode(DUSTPIN,INPUT);
  
-  //start the display
+  //start the display, 400 kHz for it and the BME 280
+  display.setBusSpeed(CLOCK_SPEED_400KHZ);
+  display.setWireBufferSize(SSD1306_WIRE_FRAME_BUFFER);
   display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(WHITE);
+  display.beginAsync();
   display.display();
 
+  //watch both I2C devices from here on
+  displayDev = i2cBus.addDevice(displayErrors,displayProbe,displayRecover);
+  bmeDev = i2cBus.addDevice(bmeErrors,bmeProbe,bmeRecover);
+
 }
 
 void loop() {
-  //get time
-  DateTime = Time.timeStr();
-  TimeOnly = DateTime.substring (11,19) ;
 
-  // connect to the mqtt server
-  MQTT_connect();
-  MQTT_ping();
+  // keep both mqtt servers connected, each one retries on its own
+  router.maintain();
+  checkPump(0);
+  checkI2C(false);
 
   //run the main loop program
   mainProgram();
+
+  //drain some queued telemetry, then send everything from this pass in one go
+  router.serviceQueue();
+#ifdef EDGE_SERVER
+  edge.flushTx();
+#endif
+  mqtt.flushTx();
+
+  //log records last, only what fits without waiting on the port; host/mqtt-log-decode prints them
+  mqttLog.drain(Serial,Serial.availableForWrite());
 }
 
 void mainProgram(){
@@ -152,27 +258,24 @@ void mainProgram(){
   if (bolFirst==true){
     timerOneSec.startTimer(100);
     timerFifSec.startTimer(1000);
-    timerTwoMin.startTimer(120000);
     timerThirtyMin.startTimer(60000);
     bolFirst=false;
   }
 
   //write time every second
   if (timerOneSec.isTimerReady()==true){
-    display.fillRect(0,0,128,10,BLACK);
-    display.setCursor(0,0);
-    display.printf("Time: %s",TimeOnly.c_str());
+    time_t now = Time.now();
+    timeField.setTime(Time.hour(now),Time.minute(now),Time.second(now));
     timerOneSec.startTimer(1000);
     display.display();
+    checkPump(0);
   }
 
-  //if the button is pushed, reset the display
+  //if the button is pushed, check the bus and repaint the display
   butPushed = digitalRead(BUTPIN);
   if (butPushed==true && butUp== true){
-    display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(WHITE);
+    checkI2C(true);
+    display.invalidate();
     display.display();
   } 
   butUp=false;
@@ -184,62 +287,56 @@ void mainProgram(){
     //air quality
     quality = sensor.slope();
     sensor.getValue();
-    display.fillRect(0,10,128,20,BLACK);
-    display.setCursor(0,10);
-    display.printf("Air Quality %i",quality);
+    airField.setInt(quality);
     
     //temperature
-    tempF = (bme.readTemperature ()*9/5)+32.0; // deg F
-    display.fillRect(0,20,128,30,BLACK);
-    display.setCursor(0,20);
-    display.printf("Temp %0.1f%cF",tempF,248);
+    checkPump(0);
+    //the display flushes from its own thread, hold the bus for the BME 280 reads
+    WITH_LOCK(Wire) {
+      tempF = (bme.readTemperature ()*9/5)+32.0; // deg F
+      pressPA = (bme.readPressure () * 0.00029530); // pascals to inches of mercury
+      humidRH = bme.readHumidity ();
+    }
+    tempField.setFixed(tempF,1,"\xF8" "F");
     
     //pressure (don't write to display)
-    pressPA = (bme.readPressure () * 0.00029530); // pascals to inches of mercury
 
     //humidity
-    humidRH = bme.readHumidity ();
-    display.fillRect(0,30,128,40,BLACK);
-    display.setCursor(0,30);
-    display.printf("Humid %0.1f",humidRH);
+    humidField.setFixed(humidRH,1);
 
     //moisture
     moistRead = analogRead(MOISTPIN);
-    display.fillRect(0,40,128,50,BLACK);
-    display.setCursor(0,40);
-    display.printf("Moisture %i",moistRead);
+    moistField.setInt(moistRead);
 
     //dust
     if(dustNum==0.0){
-      display.fillRect(0,50,128,60,BLACK);
-      display.setCursor(0,50);
-      display.printf("Dust NA");
+      dustField.set("NA");
     }
     else{
-      display.fillRect(0,50,128,60,BLACK);
-      display.setCursor(0,50);
-      display.printf("Dust %.2f",dustNum);
+      dustField.setFixed(dustNum,2);
     }
 
     //finish up
+    checkPump(0);
     display.display();
+    checkPump(0);
+
+    //publish whatever changed enough to matter, to whichever broker is up
+    if(mqtt.connected()) {
+      mqtt.maintainDns();
+    }
+    if(router.connected(MQTT_ROUTE_LOCAL) || router.connected(MQTT_ROUTE_CLOUD)) {
+      humidPolicy.update(humidRH);
+      tempPolicy.update(tempF);
+      airPolicy.update(quality);
+      moisPolicy.update(moistRead);
+      dustPolicy.update(dustNum);
+    }
+
     timerFifSec.startTimer(15000);
     pushNow=false;
   }
 
-  //publish readings every two minutes
-  if (timerTwoMin.isTimerReady()==true){
-    if(mqtt.Update()) {
-      humidFeed.publish(humidRH);
-      tempFeed.publish(tempF);
-      airFeed.publish(quality);
-      moisFeed.publish(moistRead);
-      dustFeed.publish(dustNum);
-    } 
-
-    timerTwoMin.startTimer(120000);
-  }
-
   //get dust reading every 30 minutes (first time 1 minute)
   if (timerThirtyMin.isTimerReady()==true){
     display.fillRect(0,0,128,64,BLACK);
@@ -248,46 +345,73 @@ void mainProgram(){
     display.display();
 
     dustNum = getDustNumber();
+    checkPump(0);
     display.clearDisplay();
+    for (Adafruit_SSD1306_Field *field : dashboard) {field->redraw();}
+    //put the dashboard back now rather than at the next 15 second tick
+    pushNow=true;
     timerThirtyMin.startTimer(1800000);
 
     //decide if you need to water the plant
     //if so, send a .5 second pulse of water
     if (moistRead > WATERABOVE){
       digitalWrite(PINPUMP,HIGH);
+      mqttLog.log(LOG_PUMP_AUTO,moistRead);
       timerStopWater.startTimer(500);
       bolCheckWater=true;
+      moisPolicy.force();
     }
     
   }
 
   //start water pump if the button is pressed on the web (always check)
+  checkPump(100);
+
+
+}
+
+//pump fast path: called between every stage of the loop so a web command
+//never waits behind the sensors, the display or the network
+void checkPump(int timeout){
+  //if the water timer is done, turn off the pump
+  if (timerStopWater.isTimerReady()==true && bolCheckWater==true){
+    digitalWrite(PINPUMP,LOW);
+    bolCheckWater=false;
+    //the pump is the likeliest thing to have glitched the bus, look now
+    checkI2C(true);
+    pushNow=true;
+  }
+
   Adafruit_MQTT_Subscribe *subscription;
-  while ((subscription = mqtt.readSubscription(100))) 
+  while ((subscription = router.readSubscription(timeout))) 
   {
-    if (subscription == &subFeed) 
+    //payload is parsed once on arrival, ignore anything that isn't on/off
+    if (subscription == &subFeed && subFeed.valid()) 
     {
-      pumpOnOff = atoi((char *)subFeed.lastread);
+      unsigned int dispatched = micros();
+      pumpOnOff = subFeed.value();
       if(pumpOnOff == 1){
         digitalWrite(PINPUMP,HIGH);
+        unsigned int actuated = micros();
+        pumpDispatchLatency.record(dispatched - subFeed.received_us);
+        pumpLatency.record(actuated - subFeed.received_us);
+        mqttLog.log(LOG_PUMP_WEB,actuated - subFeed.received_us,pumpLatency.percentile(99),pumpLatency.overSlo());
         timerStopWater.startTimer(500);
         bolCheckWater=true;
+        moisPolicy.force();
       }
       else{
         digitalWrite(PINPUMP,LOW);
       }
     }
   }
+}
 
-  //if the water timer is done, turn off the pump
-  if (timerStopWater.isTimerReady()==true && bolCheckWater==true){
-    digitalWrite(PINPUMP,LOW);
-    bolCheckWater=false;
-    display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
-    pushNow=true;
+//recover whichever I2C device faulted and log it
+void checkI2C(bool probeNow){
+  if (i2cBus.check(probeNow)>0){
+    mqttLog.log(LOG_I2C_FAULT,i2cBus.errors(displayDev),i2cBus.errors(bmeDev),i2cBus.busClears());
   }
-
-
 }
 
 float getDustNumber(){
@@ -295,11 +419,15 @@ float getDustNumber(){
   //to get a reading, so only do it every now and then
   bool pkeepRunning=true;
   int pLowpulseoccupancy=0;
-  int pStartTime = millis();
   int pDuration = 0;
   float pRatio = 0.0;
   float pConcentration=0.0;
 
+  //finish any watering pulse first, nothing turns the pump off during the sample
+  while (bolCheckWater == true) {checkPump(10);}
+  int pStartTime = millis();
+
+  //nothing else runs in here, anything between pulseIn calls loses low pulses
   while (pkeepRunning == true)
   {
     //bail out if you've been doing this for the sample time
@@ -309,49 +437,14 @@ float getDustNumber(){
     pDuration = pulseIn (DUSTPIN,LOW);
     pLowpulseoccupancy = pLowpulseoccupancy + pDuration ;
   }
-  pRatio = float(pLowpulseoccupancy) /(float(SAMPLETIME) * 10.0) ;
+  //the last pulseIn can run past SAMPLETIME, divide by the time actually sampled
+  pRatio = float(pLowpulseoccupancy) /(float(millis() - pStartTime) * 10.0) ;
   pConcentration = 1.1 * pow (pRatio ,3) - 3.8 * pow (pRatio,2) + 520 * pRatio + 0.62;
 
   return pConcentration;
 
 }
 
-// Function to connect and reconnect as necessary to the MQTT server.
-// Should be called in the loop function and it will take care if connecting.
-void MQTT_connect() {
-  int8_t ret;
- 
-  // Return if already connected.
-  if (mqtt.connected()) {
-    return;
-  }
- 
-  Serial.print("Connecting to MQTT... ");
-   while ((ret = mqtt.connect()) != 0) { // connect will return 0 for connected
-       Serial.printf("Error Code %s\n",mqtt.connectErrorString(ret));
-       Serial.printf("Retrying MQTT connection in 5 seconds...\n");
-       mqtt.disconnect();
-       delay(5000);  // wait 5 seconds and try again
-  }
-  Serial.printf("MQTT Connected!\n");
-}
-
-bool MQTT_ping() {
-  static unsigned int last;
-  bool pingStatus;
-
-  if ((millis()-last)>120000) {
-      //Serial.printf("Pinging MQTT \n");
-      pingStatus = mqtt.ping();
-      if(!pingStatus) {
-        Serial.printf("Disconnecting \n");
-        mqtt.disconnect();
-      }
-      last = millis();
-  }
-  return pingStatus;
-}
-
 //////////////////////////////
 // TEST CODE FROM HERE DOWN //
 //////////////////////////////
@@ -511,4 +604,4 @@ bool MQTT_ping() {
 //   digitalWrite(PINPUMP,LOW);
 //   Serial.printf("Write Low");
 //   delay(5000);
-// }
+// }
\ No newline at end of file
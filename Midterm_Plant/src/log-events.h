@@ -0,0 +1,16 @@
+#ifndef LOG_EVENTS_H
+#define LOG_EVENTS_H
+
+#include "Adafruit_MQTT_Log.h"
+
+//the sketch's log events; the device only sends the ids and arguments
+enum { LOG_BME_FAILED = MQTT_LOG_USER, LOG_PUMP_AUTO, LOG_PUMP_WEB, LOG_I2C_FAULT };
+
+//their text, in id order, for host/mqtt-log-decode; never built into the firmware
+#define LOG_EVENT_FORMATS \
+  "BME280 at address 0x%lx failed to start", \
+  "Watering, moisture %ld", \
+  "Watering from the web, %ld us after receipt (p99 %ld us, %ld over SLO)", \
+  "I2C fault, display errors %ld, BME280 errors %ld, bus clears %ld"
+
+#endif